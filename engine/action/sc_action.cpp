@@ -2058,8 +2058,12 @@ bool action_t::ready()
   if ( rng().roll( false_positive_pct() ) )
     return true;
 
-  if ( if_expr && !if_expr -> success() )
-    return false;
+  if ( if_expr )
+  {
+    stats -> expression_evaluations++;
+    if ( ! if_expr -> success() )
+      return false;
+  }
 
   return true;
 }
@@ -2313,6 +2317,14 @@ void action_t::reset()
     if ( target_if_expr ) target_if_expr = target_if_expr -> optimize();
     if( interrupt_if_expr ) interrupt_if_expr = interrupt_if_expr -> optimize();
     if( early_chain_if_expr ) early_chain_if_expr = early_chain_if_expr -> optimize();
+
+    if ( sim -> compile_expressions )
+    {
+      if_expr = expr_t::compile( if_expr );
+      target_if_expr = expr_t::compile( target_if_expr );
+      interrupt_if_expr = expr_t::compile( interrupt_if_expr );
+      early_chain_if_expr = expr_t::compile( early_chain_if_expr );
+    }
   }
 }
 
@@ -32,6 +32,7 @@ stats_t::stats_t( const std::string& n, player_t* p ) :
   total_amount( name_str + " Total Amount", p -> sim -> statistics_level < 3 ),
   portion_aps( name_str + " Portion APS", p -> sim -> statistics_level < 3 ),
   portion_apse( name_str + " Portion APSe", p -> sim -> statistics_level < 3 ),
+  expression_evaluations( 0 ),
   direct_results(),
   tick_results(),
   // Reporting only
@@ -445,6 +446,7 @@ void stats_t::merge( const stats_t& other )
   actual_amount.merge( other.actual_amount );
   portion_aps.merge( other.portion_aps );
   portion_apse.merge( other.portion_apse );
+  expression_evaluations += other.expression_evaluations;
 
   for ( result_e i = RESULT_NONE; i < RESULT_MAX; ++i )
   {
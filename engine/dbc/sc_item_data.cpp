@@ -991,7 +991,7 @@ int item_database::scaled_stat( const item_t& item, const dbc_t& dbc, size_t idx
 
 // item_database_t::initialize_item_sources =================================
 
-bool item_database::initialize_item_sources( item_t& item, std::vector<std::string>& source_list )
+bool item_database::initialize_item_sources( const item_t& item, std::vector<std::string>& source_list )
 {
   source_list = item.sim -> item_db_sources;
 
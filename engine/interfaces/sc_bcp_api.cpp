@@ -72,22 +72,10 @@ bool download_id( sim_t* sim,
   if ( item_id == 0 )
     return false;
 
-  std::string url;
-  std::string cleanurl;
-
-  if ( apikey.size() == 32 && region != "cn" ) //China does not have new api endpoints yet.
-  {
-    cleanurl = "https://" + region + ".api.battle.net/wow/item/" + util::to_string( item_id ) + "?locale=en_us&apikey=";
-    url = cleanurl + apikey;
-  }
-  else
-  {
-    url = "http://" + region + ".battle.net/api/wow/item/" + util::to_string( item_id ) + "?locale=en_US";
-    cleanurl = url;
-  }
+  http::request_t request = bcp_api::item_request( region, item_id, apikey );
 
   std::string result;
-  if ( ! download( sim, d, result, url, cleanurl, caching ) )
+  if ( ! download( sim, d, result, request.url, request.cleanurl, caching ) )
     return false;
 
   return true;
@@ -801,8 +789,47 @@ bool download_roster( rapidjson::Document& d,
   return true;
 }
 
+// character_urls ===========================================================
+
+// Set the api and armory urls of a character, from its region, server and name
+void character_urls( player_spec_t& player, const std::string& apikey )
+{
+  if ( apikey.size() == 32 && player.region != "cn" ) // China does not have new api endpoints yet.
+  {
+    std::string battlenet = "https://" + player.region + ".api.battle.net/";
+
+    player.cleanurl = battlenet + "wow/character/" +
+      player.server + '/' + player.name + "?fields=talents,items,professions&locale=en_US&apikey=";
+    player.url = player.cleanurl + apikey;
+    player.origin = battlenet + "wow/character/" + player.server + '/' + player.name + "/advanced";
+  }
+  else
+  {
+    std::string battlenet = "http://" + player.region + ".battle.net/";
+
+    player.url = battlenet + "api/wow/character/" +
+      player.server + '/' + player.name + "?fields=talents,items,professions&locale=en_US";
+    player.cleanurl = player.url;
+    player.origin = battlenet + "wow/en/character/" + player.server + '/' + player.name + "/advanced";
+  }
+}
+
 } // close anonymous namespace ==============================================
 
+// bcp_api::item_request ====================================================
+
+http::request_t bcp_api::item_request( const std::string& region, unsigned id, const std::string& apikey )
+{
+  if ( apikey.size() == 32 && region != "cn" ) //China does not have new api endpoints yet.
+  {
+    std::string cleanurl = "https://" + region + ".api.battle.net/wow/item/" + util::to_string( id ) + "?locale=en_us&apikey=";
+    return http::request_t( cleanurl + apikey, cleanurl );
+  }
+
+  std::string url = "http://" + region + ".battle.net/api/wow/item/" + util::to_string( id ) + "?locale=en_US";
+  return http::request_t( url, url );
+}
+
 // bcp_api::download_player =================================================
 
 player_t* bcp_api::download_player( sim_t*             sim,
@@ -816,14 +843,14 @@ player_t* bcp_api::download_player( sim_t*             sim,
 
   player_spec_t player;
 
+  player.region = region;
+  player.server = server;
+  player.name = name;
+
+  character_urls( player, sim -> apikey );
+
   if ( sim -> apikey.size() == 32 && region != "cn" ) // China does not have new api endpoints yet.
   {
-    std::string battlenet = "https://" + region + ".api.battle.net/";
-
-    player.cleanurl = battlenet + "wow/character/" +
-      server + '/' + name + "?fields=talents,items,professions&locale=en_US&apikey=";
-    player.url = player.cleanurl + sim -> apikey;
-    player.origin = battlenet + "wow/character/" + server + '/' + name + "/advanced";
 #ifdef SC_DEFAULT_APIKEY
   if ( sim -> apikey == std::string( SC_DEFAULT_APIKEY ) )
   //This is needed to prevent hitting the 'per second' api call limit.
@@ -837,19 +864,6 @@ player_t* bcp_api::download_player( sim_t*             sim,
 #endif
 #endif
   }
-  else
-  {
-    std::string battlenet = "http://" + region + ".battle.net/";
-
-    player.url = battlenet + "api/wow/character/" +
-      server + '/' + name + "?fields=talents,items,professions&locale=en_US";
-    player.cleanurl = player.url;
-    player.origin = battlenet + "wow/en/character/" + server + '/' + name + "/advanced";
-  }
-
-  player.region = region;
-  player.server = server;
-  player.name = name;
 
   player.talent_spec = talents;
 
@@ -947,6 +961,28 @@ bool bcp_api::download_guild( sim_t* sim,
 
   range::sort( names );
 
+  // Download the characters concurrently into the http cache, players are then created from the
+  // cache one at a time
+  std::vector<http::request_t> requests;
+  for ( const auto& cname : names )
+  {
+    player_spec_t player;
+    player.region = region;
+    player.server = server;
+    player.name = cname;
+    character_urls( player, sim -> apikey );
+    requests.push_back( http::request_t( player.url, player.cleanurl ) );
+  }
+
+  unsigned concurrency = as<unsigned>( sim -> http_concurrency );
+#ifdef SC_DEFAULT_APIKEY
+  // Stay below the 'per second' api call limit of the default apikey
+  if ( sim -> apikey == std::string( SC_DEFAULT_APIKEY ) )
+    concurrency = std::min( concurrency, 4U );
+#endif
+
+  http::prefetch( requests, caching, concurrency );
+
   for (auto & cname : names)
   {
     
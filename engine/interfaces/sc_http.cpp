@@ -5,6 +5,13 @@
 
 #include "simulationcraft.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
 // Cross-Platform Support for HTTP-Download =================================
 
 // ==========================================================================
@@ -19,7 +26,14 @@ http::proxy_t proxy;
 
 const bool HTTP_CACHE_DEBUG = false;
 
-mutex_t cache_mutex;
+// Guards url_db, in_flight and stats. Not held during downloads.
+std::mutex cache_mutex;
+
+// Urls being downloaded, other requests for them wait on download_done for the result
+std::unordered_set<std::string> in_flight;
+std::condition_variable download_done;
+
+http::statistics_t stats;
 
 const unsigned int NETBUFSIZE = 1 << 15;
 
@@ -30,21 +44,161 @@ struct url_cache_entry_t
   std::string last_modified_header;
   cache::era_t modified, validated;
 
+  // Contents of an entry loaded from the cache file point to the file mapping, and are only copied
+  // out when used. Downloading the entry again replaces them with result.
+  const char* mapped;
+  uint32_t mapped_size;
+
+  // Size of the entry's latest record in the cache file, 0 if not stored
+  size_t record_size;
+  // Downloaded contents not yet appended to the cache file
+  bool dirty;
+
   url_cache_entry_t() :
-    modified( cache::INVALID_ERA ), validated( cache::INVALID_ERA )
+    modified( cache::INVALID_ERA ), validated( cache::INVALID_ERA ),
+    mapped( nullptr ), mapped_size( 0 ), record_size( 0 ), dirty( false )
   {}
+
+  std::string contents() const
+  { return mapped ? std::string( mapped, mapped_size ) : result; }
 };
 
 typedef std::unordered_map<std::string, url_cache_entry_t> url_db_t;
 url_db_t url_db;
 
+// Cache file ===============================================================
+
+// The cache file is an append-only sequence of records following a header:
+//   header: "simc-http-cache-2\0" SC_VERSION "\0"
+//   record: uint32_t url size, last modified size, contents size, url, last modified, contents
+// A later record of an url supersedes the earlier ones. Loading maps the file and indexes the
+// records by reading their url and last modified header only. Saving appends the entries
+// downloaded since, and rewrites the file only when it is not appendable or mostly superseded
+// records.
+//
+// Processes sharing a cache file serialize loading, appending and rewriting with an advisory lock
+// of "<cache file>.lock". A rewrite drops the records other processes appended since the file was
+// loaded, they are downloaded again when needed.
+
+const char CACHE_FILE_MAGIC[] = "simc-http-cache-2";
+
+struct cache_file_t
+{
+  io::mapped_file_t map;
+  std::string name;
+  size_t end;       // End of the last complete record
+  size_t dead;      // Size of the superseded records
+  bool appendable;  // The file has the current header, no trailing garbage, and the cache has not been cleared
+
+  cache_file_t() : end( 0 ), dead( 0 ), appendable( false )
+  { }
+} cache_file;
+
+std::string cache_file_lock_name( const std::string& file_name )
+{
+  return file_name + ".lock";
+}
+
+std::string cache_file_header()
+{
+  return std::string( CACHE_FILE_MAGIC, sizeof( CACHE_FILE_MAGIC ) ) +
+         std::string( SC_VERSION, std::strlen( SC_VERSION ) + 1 );
+}
+
+// Append the record of an entry to the file, returns the size of the record
+size_t write_record( std::ostream& os, const std::string& url, const url_cache_entry_t& entry )
+{
+  const char* contents = entry.mapped ? entry.mapped : entry.result.data();
+  uint32_t sizes[ 3 ] = {
+    as<uint32_t>( url.size() ),
+    as<uint32_t>( entry.last_modified_header.size() ),
+    entry.mapped ? entry.mapped_size : as<uint32_t>( entry.result.size() )
+  };
+
+  os.write( reinterpret_cast<const char*>( sizes ), sizeof( sizes ) );
+  os.write( url.data(), sizes[ 0 ] );
+  os.write( entry.last_modified_header.data(), sizes[ 1 ] );
+  os.write( contents, sizes[ 2 ] );
+
+  return sizeof( sizes ) + sizes[ 0 ] + sizes[ 1 ] + sizes[ 2 ];
+}
+
+// Map the cache file and index its records. Newly indexed entries are valid from the beginning
+// of time, entries already in the cache keep their eras. Requires cache_mutex to be held.
+void index_cache_file( const std::string& file_name )
+{
+  // Entries must not point to a mapping that is about to be closed
+  for ( auto& entry : url_db )
+  {
+    url_cache_entry_t& c = entry.second;
+    if ( c.mapped )
+    {
+      c.result.assign( c.mapped, c.mapped_size );
+      c.mapped = nullptr;
+    }
+    c.record_size = 0;
+    c.dirty = c.validated != cache::INVALID_ERA;
+  }
+
+  cache_file.map.close();
+  cache_file.name = file_name;
+  cache_file.end = cache_file.dead = 0;
+  cache_file.appendable = false;
+
+  if ( ! cache_file.map.open( file_name ) )
+    return;
+
+  const char* data = cache_file.map.data();
+  size_t size = cache_file.map.size();
+
+  std::string header = cache_file_header();
+  if ( size < header.size() || header.compare( 0, header.size(), data, header.size() ) != 0 )
+  {
+    // Different format or version, rewritten on save
+    cache_file.map.close();
+    return;
+  }
+
+  size_t pos = header.size();
+  uint32_t sizes[ 3 ];
+  while ( size - pos >= sizeof( sizes ) )
+  {
+    std::memcpy( sizes, data + pos, sizeof( sizes ) );
+
+    size_t record_size = sizeof( sizes ) + static_cast<size_t>( sizes[ 0 ] ) + sizes[ 1 ] + sizes[ 2 ];
+    if ( record_size > size - pos )
+      break;
+
+    const char* p = data + pos + sizeof( sizes );
+
+    url_cache_entry_t& c = url_db[ std::string( p, sizes[ 0 ] ) ];
+    cache_file.dead += c.record_size;
+    if ( c.validated == cache::INVALID_ERA )
+      c.modified = c.validated = cache::IN_THE_BEGINNING;
+    c.last_modified_header.assign( p + sizes[ 0 ], sizes[ 1 ] );
+    c.result.clear();
+    c.mapped = p + sizes[ 0 ] + sizes[ 1 ];
+    c.mapped_size = sizes[ 2 ];
+    c.record_size = record_size;
+    c.dirty = false;
+
+    pos += record_size;
+  }
+
+  cache_file.end = pos;
+  cache_file.appendable = pos == size;
+}
+
 // cache_clear ==============================================================
 
 void cache_clear()
 {
   // writer lock
-  auto_lock_t lock( cache_mutex );
+  std::lock_guard<std::mutex> lock( cache_mutex );
   url_db.clear();
+
+  // The cleared entries are dropped from the cache file on save
+  cache_file.appendable = false;
 }
 
 const char* const cookies =
@@ -86,8 +240,6 @@ bool download( url_cache_entry_t&,
 bool download( url_cache_entry_t& entry,
                       const std::string& url )
 {
-  // Requires cache_mutex to be held.
-
   class InetWrapper : private noncopyable
   {
   public:
@@ -98,14 +250,11 @@ bool download( url_cache_entry_t& entry,
     operator HINTERNET () const { return handle; }
   };
 
-  static HINTERNET hINet;
-  if ( !hINet )
-  {
-    // hINet = InternetOpen( L"simulationcraft", INTERNET_OPEN_TYPE_PROXY, "proxy-server", NULL, 0 );
-    hINet = InternetOpenW( L"simulationcraft", INTERNET_OPEN_TYPE_PRECONFIG, NULL, NULL, 0 );
-    if ( ! hINet )
-      return false;
-  }
+  // Downloads run concurrently, the session handle is opened once and shared
+  // hINet = InternetOpen( L"simulationcraft", INTERNET_OPEN_TYPE_PROXY, "proxy-server", NULL, 0 );
+  static HINTERNET hINet = InternetOpenW( L"simulationcraft", INTERNET_OPEN_TYPE_PRECONFIG, NULL, NULL, 0 );
+  if ( ! hINet )
+    return false;
 
   std::wstring headers = io::widen( cookies );
 
@@ -176,6 +325,7 @@ bool download( url_cache_entry_t& entry,
 #include <windows.h>
 #include <wininet.h>
 #include <Winsock2.h>
+#include <ws2tcpip.h>
 #include <io.h> // for POSIX ::close
 
 #else
@@ -212,28 +362,36 @@ struct SocketWrapper
 
 int SocketWrapper::connect( const std::string& host, unsigned short port )
 {
-  struct hostent* h;
   sockaddr_in a;
 
   a.sin_family = AF_INET;
 
+  // Resolve with getaddrinfo, gethostbyname is not safe to use from concurrent downloads
+  addrinfo hints;
+  std::memset( &hints, 0, sizeof( hints ) );
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+
+  addrinfo* h = nullptr;
+  int ret;
   if ( proxy.type == "http" || proxy.type == "https" )
   {
-    h = gethostbyname( proxy.host.c_str() );
+    ret = getaddrinfo( proxy.host.c_str(), nullptr, &hints, &h );
     a.sin_port = htons( proxy.port );
   }
   else
   {
-    h = gethostbyname( host.c_str() );
+    ret = getaddrinfo( host.c_str(), nullptr, &hints, &h );
     a.sin_port = htons( port );
   }
-  if ( ! h ) return -1;
+  if ( ret != 0 || ! h ) return -1;
+
+  a.sin_addr = reinterpret_cast<const sockaddr_in*>( h -> ai_addr ) -> sin_addr;
+  freeaddrinfo( h );
 
   if ( ( fd = ::socket( PF_INET, SOCK_STREAM, IPPROTO_TCP ) ) < 0 )
     return -1;
 
-  std::memcpy( &a.sin_addr, h -> h_addr_list[ 0 ], sizeof( a.sin_addr ) );
-
   return ::connect( fd, reinterpret_cast<const sockaddr*>( &a ), sizeof( a ) );
 }
 
@@ -246,14 +404,30 @@ struct SSLWrapper
 
   static void init()
   {
-    if ( ! ctx )
-    {
+    static std::once_flag initialized;
+    std::call_once( initialized, []() {
       SSL_library_init();
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+      // OpenSSL before 1.1.0 needs locking callbacks to be used from concurrent downloads
+      CRYPTO_set_locking_callback( &SSLWrapper::lock );
+#endif
       ctx = SSL_CTX_new( SSLv23_client_method() );
       SSL_CTX_set_mode( ctx, SSL_MODE_AUTO_RETRY );
-    }
+    } );
   }
 
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+  static void lock( int mode, int n, const char*, int )
+  {
+    static std::vector<std::mutex> locks( CRYPTO_num_locks() );
+
+    if ( mode & CRYPTO_LOCK )
+      locks[ n ].lock();
+    else
+      locks[ n ].unlock();
+  }
+#endif
+
   SSL* s;
   SSLWrapper() : s( SSL_new( ctx ) ) {}
 
@@ -604,13 +778,11 @@ bool download( url_cache_entry_t& entry,
 {
 #if defined( SC_MINGW )
 
-  static bool initialized = false;
-  if ( ! initialized )
-  {
+  static std::once_flag initialized;
+  std::call_once( initialized, []() {
     WSADATA wsa_data;
     WSAStartup( MAKEWORD( 2, 2 ), &wsa_data );
-    initialized = true;
-  }
+  } );
 
 #endif
 
@@ -774,95 +946,109 @@ bool http::clear_cache( sim_t* sim,
 
 // http::cache_load =========================================================
 
-namespace cache {
-std::string get( std::istream& is )
+void http::cache_load( const std::string& file_name )
 {
-  std::string result;
-  while ( is )
-  {
-    unsigned char c = is.get();
-    if ( ! c )
-      break;
-    result += c;
-  }
-  return result;
-}
-
-void put( std::ostream& os, const std::string& s )
-{ os.write( s.c_str(), s.size() + 1 ); }
+  std::lock_guard<std::mutex> lock( cache_mutex );
+  io::file_lock_t file_lock( cache_file_lock_name( file_name ) );
 
-void put( std::ostream& os, const char* s )
-{ os.write( s, std::strlen( s ) + 1 ); }
+  index_cache_file( file_name );
 }
 
-void http::cache_load( const std::string& file_name )
+// http::cache_save =========================================================
+
+void http::cache_save( const std::string& file_name )
 {
-  auto_lock_t lock( cache_mutex );
+  std::lock_guard<std::mutex> lock( cache_mutex );
 
-  try
+  // Records superseded by the entries to append
+  size_t n_dirty = 0, superseded = 0;
+  for ( const auto& entry : url_db )
   {
-    io::ifstream file;
-    file.open( file_name, std::ios::binary );
-    if ( !file ) return;
-    file.exceptions( std::ios::eofbit | std::ios::failbit | std::ios::badbit );
-    file.unsetf( std::ios::skipws );
-
-    if ( cache::get( file ) != SC_VERSION )
+    if ( entry.second.dirty && entry.second.validated != cache::INVALID_ERA )
     {
-      // invalid version, GTFO
-      return;
+      ++n_dirty;
+      superseded += entry.second.record_size;
     }
+  }
+
+  bool appendable = cache_file.appendable && file_name == cache_file.name;
 
-    std::string content;
-    content.reserve( 16 * 1024 );
+  // Nothing downloaded, the file is up to date
+  if ( appendable && n_dirty == 0 )
+    return;
 
-    while ( ! file.eof() )
+  bool rewrite = ! appendable || 2 * ( cache_file.dead + superseded ) > cache_file.end;
+
+  // Without the lock, another process could be writing the file
+  io::file_lock_t file_lock( cache_file_lock_name( file_name ) );
+  if ( ! file_lock.is_locked() )
+    return;
+
+  try
+  {
+    if ( ! rewrite )
     {
-      std::string url = cache::get( file );
-      std::string last_modified = cache::get( file );
+      io::ofstream file;
+      file.open( file_name, std::ios::binary | std::ios::app );
+      if ( ! file ) return;
+      file.exceptions( std::ios::eofbit | std::ios::failbit | std::ios::badbit );
 
-      uint32_t size;
-      file.read( reinterpret_cast<char*>( &size ), sizeof( size ) );
-      content.resize( size );
-      file.read( &content[ 0 ], size );
+      for ( auto& entry : url_db )
+      {
+        url_cache_entry_t& c = entry.second;
+        if ( ! c.dirty || c.validated == cache::INVALID_ERA )
+          continue;
 
-      url_cache_entry_t& c = url_db[ url ];
-      c.result = content;
-      c.last_modified_header = last_modified;
-      c.modified = c.validated = cache::IN_THE_BEGINNING;
+        size_t record_size = write_record( file, entry.first, c );
+        cache_file.dead += c.record_size;
+        cache_file.end += record_size;
+        c.record_size = record_size;
+        c.dirty = false;
+      }
+
+      return;
     }
-  }
-  catch ( ... )
-  {}
-}
 
-// http::cache_save =========================================================
+    // Write all entries to a new file, and replace the old one with it
+    std::string tmp_file = file_name + ".tmp";
+    {
+      io::ofstream file;
+      file.open( tmp_file, std::ios::binary );
+      if ( ! file ) return;
+      file.exceptions( std::ios::eofbit | std::ios::failbit | std::ios::badbit );
 
-void http::cache_save( const std::string& file_name )
-{
-  auto_lock_t lock( cache_mutex );
+      std::string header = cache_file_header();
+      file.write( header.data(), header.size() );
 
-  try
-  {
-    io::ofstream file;
-    file.open( file_name, std::ios::binary );
-    if ( ! file ) return;
-    file.exceptions( std::ios::eofbit | std::ios::failbit | std::ios::badbit );
+      for ( const auto& entry : url_db )
+      {
+        if ( entry.second.validated == cache::INVALID_ERA )
+          continue;
 
-    cache::put( file, SC_VERSION );
+        write_record( file, entry.first, entry.second );
+      }
+    }
 
-    for ( url_db_t::const_iterator p = url_db.begin(), e = url_db.end(); p != e; ++p )
+    // Contents are copied out of the old mapping before it is closed
+    for ( auto& entry : url_db )
     {
-      if ( p -> second.validated == cache::INVALID_ERA )
-        continue;
-
-      cache::put( file, p -> first );
-      cache::put( file, p -> second.last_modified_header );
+      url_cache_entry_t& c = entry.second;
+      if ( c.mapped )
+      {
+        c.result.assign( c.mapped, c.mapped_size );
+        c.mapped = nullptr;
+      }
+    }
+    cache_file.map.close();
 
-      uint32_t size = as<uint32_t>( p -> second.result.size() );
-      file.write( reinterpret_cast<const char*>( &size ), sizeof( size ) );
-      file.write( p -> second.result.data(), size );
+    if ( std::rename( tmp_file.c_str(), file_name.c_str() ) != 0 )
+    {
+      // Renaming over an existing file fails on some platforms
+      std::remove( file_name.c_str() );
+      std::rename( tmp_file.c_str(), file_name.c_str() );
     }
+
+    index_cache_file( file_name );
   }
   catch ( ... )
   {}
@@ -870,6 +1056,12 @@ void http::cache_save( const std::string& file_name )
 
 // http::get ================================================================
 
+/**
+ * Get the contents of an url, from the cache or by downloading it. The cache
+ * mutex is released for the duration of the download, so downloads of
+ * different urls run concurrently. Concurrent requests for an url that is
+ * being downloaded wait for the download, and share its result.
+ */
 bool http::get( std::string&       result,
                 const std::string& url,
                 const std::string& cleanurl,
@@ -883,8 +1075,17 @@ bool http::get( std::string&       result,
   util::urlencode( encoded_url );
   util::urlencode( encoded_clean_url );
 
-  auto_lock_t lock( cache_mutex );
+  std::unique_lock<std::mutex> lock( cache_mutex );
 
+  ++stats.requests;
+
+  auto needs_download = [ caching ]( const url_cache_entry_t& entry ) {
+    return entry.validated < cache::era() &&
+           ( caching == cache::CURRENT || entry.validated == cache::INVALID_ERA );
+  };
+
+  // Note, url_db entries must be looked up again after the mutex has been released, as the cache
+  // may have been cleared in the meantime
   url_cache_entry_t& entry = url_db[ encoded_clean_url ];
 
   if ( HTTP_CACHE_DEBUG )
@@ -908,42 +1109,140 @@ bool http::get( std::string&       result,
       }
       else
         http_log << "miss";
-      if ( caching != cache::ONLY &&
-           ( entry.validated == cache::INVALID_ERA ||
-             ( caching == cache::CURRENT && entry.validated < cache::era() ) ) )
+      if ( caching != cache::ONLY && needs_download( entry ) )
         http_log << " download";
+      if ( in_flight.count( encoded_clean_url ) )
+        http_log << " shared";
       http_log << "]\n";
     }
   }
 
-  if ( entry.validated < cache::era() && ( caching == cache::CURRENT || entry.validated == cache::INVALID_ERA ) )
+  if ( ! needs_download( entry ) )
   {
-    if ( caching == cache::ONLY )
-      return false;
+    ++stats.hits;
+    result = entry.contents();
+    return true;
+  }
 
-    util::printf( "@" ); fflush( stdout );
+  if ( caching == cache::ONLY )
+    return false;
+
+  // Another request is downloading the url, use its result. The url still needing a download
+  // after the wait means the download failed.
+  if ( in_flight.count( encoded_clean_url ) )
+  {
+    ++stats.shared;
 
-    if ( ! download( entry, encoded_url ) )
+    download_done.wait( lock, [ &encoded_clean_url ]() {
+      return in_flight.count( encoded_clean_url ) == 0;
+    } );
+
+    const url_cache_entry_t& shared_entry = url_db[ encoded_clean_url ];
+    if ( needs_download( shared_entry ) )
       return false;
 
-    if ( HTTP_CACHE_DEBUG && entry.modified < entry.validated )
-    {
-      io::ofstream http_log;
-      http_log.open( "simc_http_log.txt", std::ios::app );
-      http_log << cache::era() << ": Unmodified (" << entry.modified << ", " << entry.validated << ")\n";
-    }
+    result = shared_entry.contents();
+    return true;
+  }
+
+  in_flight.insert( encoded_clean_url );
+
+  // Download into a copy of the entry, a not modified response keeps the cached contents
+  url_cache_entry_t download_entry = entry;
+
+  lock.unlock();
+
+  util::printf( "@" ); fflush( stdout );
+
+  auto start = std::chrono::steady_clock::now();
+  bool success = download( download_entry, encoded_url );
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  lock.lock();
+
+  in_flight.erase( encoded_clean_url );
+  download_done.notify_all();
+
+  stats.download_time += elapsed.count();
 
-    if ( confirmation.size() && ( entry.result.find( confirmation ) == std::string::npos ) )
+  if ( ! success )
+  {
+    ++stats.failures;
+    return false;
+  }
+
+  ++stats.downloads;
+  stats.bytes += download_entry.result.size();
+
+  if ( HTTP_CACHE_DEBUG && download_entry.modified < download_entry.validated )
+  {
+    io::ofstream http_log;
+    http_log.open( "simc_http_log.txt", std::ios::app );
+    http_log << cache::era() << ": Unmodified (" << download_entry.modified << ", " << download_entry.validated << ")\n";
+  }
+
+  // Modified contents replace the ones in the cache file
+  if ( download_entry.modified == download_entry.validated )
+  {
+    download_entry.mapped = nullptr;
+    download_entry.mapped_size = 0;
+    download_entry.dirty = true;
+  }
+
+  url_cache_entry_t& new_entry = url_db[ encoded_clean_url ];
+  new_entry = std::move( download_entry );
+  result = new_entry.contents();
+
+  if ( confirmation.size() && ( result.find( confirmation ) == std::string::npos ) )
+  {
+    //util::printf( "\nsimulationcraft: HTTP failed on '%s'\n", url.c_str() );
+    //util::printf( "%s\n", ( result.empty() ? "empty" : result.c_str() ) );
+    //fflush( stdout );
+    result.clear();
+    return false;
+  }
+
+  return true;
+}
+
+// http::prefetch ===========================================================
+
+void http::prefetch( const std::vector<request_t>& requests,
+                     cache::behavior_e             caching,
+                     unsigned                      max_concurrency )
+{
+  if ( requests.empty() || caching == cache::ONLY )
+    return;
+
+  std::atomic<size_t> index( 0 );
+  auto fetch = [ &requests, &index, caching ]() {
+    std::string result;
+    for ( size_t i = index++; i < requests.size(); i = index++ )
     {
-      //util::printf( "\nsimulationcraft: HTTP failed on '%s'\n", url.c_str() );
-      //util::printf( "%s\n", ( result.empty() ? "empty" : result.c_str() ) );
-      //fflush( stdout );
-      return false;
+      http::get( result, requests[ i ].url, requests[ i ].cleanurl, caching );
     }
+  };
+
+  size_t n_threads = std::min( std::max( max_concurrency, 1U ), as<unsigned>( requests.size() ) );
+
+  std::vector<std::thread> threads;
+  for ( size_t i = 1; i < n_threads; ++i )
+  {
+    threads.push_back( std::thread( fetch ) );
   }
 
-  result = entry.result;
-  return true;
+  fetch();
+
+  range::for_each( threads, []( std::thread& thread ) { thread.join(); } );
+}
+
+// http::statistics =========================================================
+
+http::statistics_t http::statistics()
+{
+  std::lock_guard<std::mutex> lock( cache_mutex );
+
+  return stats;
 }
 
 #ifdef UNIT_TEST
@@ -955,7 +1254,31 @@ void sim_t::errorf( const char*, ... ) { }
 
 int main( int argc, char* argv[] )
 {
-  if ( argc > 1 )
+  if ( argc > 2 && !strcmp( argv[ 1 ], "--concurrent" ) )
+  {
+    // Fetch the urls concurrently, twice each, and print the cache statistics. Run against a local
+    // http server to check de-duplication and hit counting, and run again to check the cache file.
+    const char* const url_cache_file = "simc_cache.dat";
+    http::cache_load( url_cache_file );
+
+    std::vector<http::request_t> requests;
+    for ( int i = 2; i < argc; ++i )
+    {
+      requests.push_back( http::request_t( argv[ i ], argv[ i ] ) );
+      requests.push_back( http::request_t( argv[ i ], argv[ i ] ) );
+    }
+
+    http::prefetch( requests, cache::CURRENT, 8 );
+
+    http::statistics_t stats = http::statistics();
+    std::cout << "requests=" << stats.requests << " hits=" << stats.hits
+              << " downloads=" << stats.downloads << " shared=" << stats.shared
+              << " failures=" << stats.failures << " bytes=" << stats.bytes
+              << " download_time=" << stats.download_time << '\n';
+
+    http::cache_save( url_cache_file );
+  }
+  else if ( argc > 1 )
   {
     for ( int i = 1; i < argc; ++i )
     {
@@ -968,13 +1291,13 @@ int main( int argc, char* argv[] )
         for ( auto& i : url_db )
         {
           std::cout << "URL: \"" << i.first << "\" (" << i.second.last_modified_header << ")\n"
-                    << i.second.result << '\n';
+                    << i.second.contents() << '\n';
         }
       }
       else
       {
         std::string result;
-        if ( http::get( result, argv[ i ], cache::CURRENT ) )
+        if ( http::get( result, argv[ i ], argv[ i ], cache::CURRENT ) )
           std::cout << result << '\n';
         else
           std::cout << "Unable to download \"" << argv[ i ] << "\".\n";
@@ -985,12 +1308,12 @@ int main( int argc, char* argv[] )
   {
     std::string result;
 
-    if ( http::get( result, "http://us.battle.net/wow/en/character/llane/pagezero/advanced", cache::CURRENT ) )
+    if ( http::get( result, "http://us.battle.net/wow/en/character/llane/pagezero/advanced", "http://us.battle.net/wow/en/character/llane/pagezero/advanced", cache::CURRENT ) )
       std::cout << result << '\n';
     else
       std::cout << "Unable to download armory data.\n";
 
-    if ( http::get( result, "http://www.wowhead.com/list=1564664", cache::CURRENT ) )
+    if ( http::get( result, "http://www.wowhead.com/list=1564664", "http://www.wowhead.com/list=1564664", cache::CURRENT ) )
       std::cout << result << '\n';
     else
       std::cout << "Unable to download wowhead data.\n";
@@ -46,10 +46,9 @@ std::shared_ptr<xml_node_t> download_id( sim_t*             sim,
   if ( ! id )
     return std::shared_ptr<xml_node_t>();
 
-  std::string url_www = "http://" + source_str( source ) + ".wowhead.com/item="
-                        + util::to_string( id ) + "&xml";
+  http::request_t request = wowhead::item_request( id, source );
 
-  std::shared_ptr<xml_node_t> node = xml_node_t::get( sim, url_www, url_www, caching, "</json>" );
+  std::shared_ptr<xml_node_t> node = xml_node_t::get( sim, request.url, request.cleanurl, caching, "</json>" );
   if ( sim -> debug && node ) node -> print();
   return node;
 }
@@ -328,6 +327,16 @@ bool wowhead::download_item( item_t&            item,
   return ret;
 }
 
+// wowhead::item_request ====================================================
+
+http::request_t wowhead::item_request( unsigned id, wowhead_e source )
+{
+  std::string url_www = "http://" + source_str( source ) + ".wowhead.com/item="
+                        + util::to_string( id ) + "&xml";
+
+  return http::request_t( url_www, url_www );
+}
+
 std::string wowhead::domain_str( wowhead_e domain )
 {
   switch ( domain )
@@ -2059,6 +2059,70 @@ bool item_t::download_item( item_t& item )
   return success;
 }
 
+// item_t::prefetch_items ===================================================
+
+// Download the items that item_t::download_item would download concurrently into the http cache,
+// so that initializing the items one at a time afterwards only hits the cache. Must be called
+// after item_t::parse_options.
+void item_t::prefetch_items( const std::vector<item_t>& items )
+{
+  if ( items.empty() || cache::items() == cache::ONLY )
+    return;
+
+  sim_t* sim = items.front().sim;
+
+  std::vector<http::request_t> requests;
+  for ( const auto& item : items )
+  {
+    if ( item.parsed.data.id == 0 )
+      continue;
+
+    std::vector<std::string> sources;
+    if ( ! item_database::initialize_item_sources( item, sources ) )
+      continue;
+
+    std::vector<http::request_t> item_requests;
+    bool found = false;
+    for ( const auto& source : sources )
+    {
+      if ( source == "local" )
+      {
+        // Local data is only used when not forcing current data
+        const item_data_t* data = item.player -> dbc.item( item.parsed.data.id );
+        found = cache::items() != cache::CURRENT && data && data -> id;
+      }
+      else if ( source == "wowhead" )
+        item_requests.push_back( wowhead::item_request( item.parsed.data.id, wowhead::LIVE ) );
+      else if ( source == "ptrhead" )
+        item_requests.push_back( wowhead::item_request( item.parsed.data.id, wowhead::PTR ) );
+#if SC_BETA
+      else if ( source == SC_BETA_STR "head" )
+        item_requests.push_back( wowhead::item_request( item.parsed.data.id, wowhead::BETA ) );
+#endif
+      else if ( source == "bcpapi" )
+        item_requests.push_back( bcp_api::item_request( item.player -> region_str, item.parsed.data.id, sim -> apikey ) );
+
+      if ( found )
+        break;
+    }
+
+    if ( found || item_requests.empty() )
+      continue;
+
+    // A cached copy of any source is used before downloading
+    std::string result;
+    if ( cache::items() != cache::CURRENT &&
+         range::find_if( item_requests, [ &result ]( const http::request_t& r ) {
+           return http::get( result, r.url, r.cleanurl, cache::ONLY );
+         } ) != item_requests.end() )
+      continue;
+
+    requests.push_back( item_requests.front() );
+  }
+
+  http::prefetch( requests, cache::items(), as<unsigned>( sim -> http_concurrency ) );
+}
+
 // item_t::init_special_effects =============================================
 
 bool item_t::init_special_effects()
@@ -974,6 +974,24 @@ void player_t::init()
   {
     collected_data.fight_length.change_mode( false ); // Not simple
   }
+
+  // Lean collecting sims only keep the iterations of their profileset metrics. Like
+  // single_actor_batch above, lean_collection is set after the actors are constructed (by the
+  // profileset or the parent sim), so the containers are switched here.
+  if ( sim -> lean_collection )
+  {
+    auto lean = [ this ]( extended_sample_data_t& data, scale_metric_e metric ) {
+      if ( range::find( sim -> profileset_metric, metric ) == sim -> profileset_metric.end() )
+      {
+        data.change_mode( true ); // Simple
+      }
+    };
+
+    lean( collected_data.prioritydps, SCALE_METRIC_DPSP );
+    lean( collected_data.dps, SCALE_METRIC_DPS );
+    lean( collected_data.hps, SCALE_METRIC_HPS );
+    lean( collected_data.aps, SCALE_METRIC_APS );
+  }
 }
 
 /* Determine Spec, Talents, Professions
@@ -1237,7 +1255,13 @@ bool player_t::init_items()
       sim -> cancel();
       return false;
     }
+  }
+
+  // Download the items concurrently, initialization below then uses the cached data
+  item_t::prefetch_items( items );
 
+  for ( auto& item : items )
+  {
     if ( ! item.initialize_data() )
     {
       sim -> errorf( "Unable to initialize item '%s' base data on player '%s'\n", item.name(), name() );
@@ -1546,7 +1570,7 @@ void player_t::init_resources( bool force )
   resources.current = resources.max = resources.initial;
 
   // Only collect pet resource timelines if they get reported separately
-  if ( ! is_pet() || sim -> report_pets_separately )
+  if ( ( ! is_pet() || sim -> report_pets_separately ) && ! sim -> lean_collection )
   {
     if ( collected_data.resource_timelines.size() == 0 )
     {
@@ -4036,6 +4060,28 @@ void player_t::datacollection_end()
 
 // player_t::merge ==========================================================
 
+namespace {
+
+// Find the entry of other's list that matches list[ index ]. Actors in
+// different threads are initialized identically, so the entry at the same
+// index almost always matches; fall back to a name lookup otherwise.
+template <typename T>
+T* find_merge_member( const std::vector<T*>& list, const std::vector<T*>& other_list, size_t index )
+{
+  const std::string& name = list[ index ] -> name_str;
+  if ( index < other_list.size() && other_list[ index ] -> name_str == name )
+    return other_list[ index ];
+
+  for ( auto t : other_list )
+  {
+    if ( t -> name_str == name )
+      return t;
+  }
+  return nullptr;
+}
+
+} // unnamed namespace
+
 namespace { namespace buff_merge {
 
 // a < b iff ( a.name < b.name || ( a.name == b.name && a.source < b.source ) )
@@ -4171,7 +4217,7 @@ void player_t::merge( player_t& other )
   for ( size_t i = 0; i < proc_list.size(); ++i )
   {
     proc_t& proc = *proc_list[ i ];
-    if ( proc_t* other_proc = other.find_proc( proc.name_str ) )
+    if ( proc_t* other_proc = find_merge_member( proc_list, other.proc_list, i ) )
       proc.merge( *other_proc );
     else
     {
@@ -4185,7 +4231,7 @@ void player_t::merge( player_t& other )
   for ( size_t i = 0; i < gain_list.size(); ++i )
   {
     gain_t& gain = *gain_list[ i ];
-    if ( gain_t* other_gain = other.find_gain( gain.name_str ) )
+    if ( gain_t* other_gain = find_merge_member( gain_list, other.gain_list, i ) )
       gain.merge( *other_gain );
     else
     {
@@ -4199,7 +4245,7 @@ void player_t::merge( player_t& other )
   for ( size_t i = 0; i < stats_list.size(); ++i )
   {
     stats_t& stats = *stats_list[ i ];
-    if ( stats_t* other_stats = other.find_stats( stats.name_str ) )
+    if ( stats_t* other_stats = find_merge_member( stats_list, other.stats_list, i ) )
       stats.merge( *other_stats );
     else
     {
@@ -4213,7 +4259,7 @@ void player_t::merge( player_t& other )
   for ( size_t i = 0; i < uptime_list.size(); ++i )
   {
     uptime_t& uptime = *uptime_list[ i ];
-    if ( uptime_t* other_uptime = other.find_uptime( uptime.name_str ) )
+    if ( uptime_t* other_uptime = find_merge_member( uptime_list, other.uptime_list, i ) )
       uptime.merge( *other_uptime );
     else
     {
@@ -4227,7 +4273,7 @@ void player_t::merge( player_t& other )
   for ( size_t i = 0; i < benefit_list.size(); ++i )
   {
     benefit_t& benefit = *benefit_list[ i ];
-    if ( benefit_t* other_benefit = other.find_benefit( benefit.name_str ) )
+    if ( benefit_t* other_benefit = find_merge_member( benefit_list, other.benefit_list, i ) )
       benefit.merge( *other_benefit );
     else
     {
@@ -4241,7 +4287,7 @@ void player_t::merge( player_t& other )
   for ( size_t i = 0; i < sample_data_list.size(); ++i )
   {
     luxurious_sample_data_t& sd = *sample_data_list[ i ];
-    if ( luxurious_sample_data_t* other_sd = other.find_sample_data( sd.name_str ) )
+    if ( luxurious_sample_data_t* other_sd = find_merge_member( sample_data_list, other.sample_data_list, i ) )
       sd.merge( *other_sd );
     else
     {
@@ -10569,26 +10615,6 @@ void player_t::analyze( sim_t& s )
     } );
   }
 
-  // Actor Lists ============================================================
-
-  if ( ! quiet && ! is_enemy() && ! is_add() && ! ( is_pet() && s.report_pets_separately ) )
-  {
-    s.players_by_dps.push_back( this );
-    s.players_by_priority_dps.push_back( this );
-    s.players_by_hps.push_back( this );
-    s.players_by_hps_plus_aps.push_back( this );
-    s.players_by_dtps.push_back( this );
-    s.players_by_tmi.push_back( this );
-    s.players_by_name.push_back( this );
-    s.players_by_apm.push_back( this );
-    s.players_by_variance.push_back( this );
-  }
-
-  if ( ! quiet && ( is_enemy() || is_add() ) && ! ( is_pet() && s.report_pets_separately ) )
-  {
-    s.targets_by_name.push_back( this );
-  }
-
   // Resources & Gains ======================================================
 
   if ( static_cast<size_t>( primary_resource() ) < collected_data.resource_lost.size() )
@@ -10663,7 +10689,7 @@ void player_t::analyze( sim_t& s )
 // Return sample_data reference over which this player gets scaled ( scale factors, reforge plots, etc. )
 // By default this will be his personal dps or hps
 
-scaling_metric_data_t player_t::scaling_for_metric( scale_metric_e metric ) const
+const player_t* player_t::scaling_player() const
 {
   const player_t* q = nullptr;
   if ( ! sim -> scaling -> scale_over_player.empty() )
@@ -10671,6 +10697,13 @@ scaling_metric_data_t player_t::scaling_for_metric( scale_metric_e metric ) cons
   if ( !q )
     q = this;
 
+  return q;
+}
+
+scaling_metric_data_t player_t::scaling_for_metric( scale_metric_e metric ) const
+{
+  const player_t* q = scaling_player();
+
   switch ( metric )
   {
     case SCALE_METRIC_DPS:        return scaling_metric_data_t( metric, q -> collected_data.dps );
@@ -10701,6 +10734,44 @@ scaling_metric_data_t player_t::scaling_for_metric( scale_metric_e metric ) cons
   }
 }
 
+// Standard deviation of the mean of the paired differences between the scaling metric of this
+// player and the reference player. Iterations of the two sims are paired up by the rng stream they
+// were simulated with ( paired_sampling ), so that the variance both sims share cancels out.
+// Returns 0 if the metric has no per-iteration samples to pair up.
+
+double player_t::scaling_paired_std_dev( const player_t& ref, scale_metric_e metric ) const
+{
+  auto data = scaling_for_metric( metric );
+  auto ref_data = ref.scaling_for_metric( metric );
+  const auto& streams = scaling_player() -> collected_data.iteration_streams;
+  const auto& ref_streams = ref.scaling_player() -> collected_data.iteration_streams;
+
+  if ( ! data.samples || ! ref_data.samples ||
+       data.samples -> data().size() != streams.size() ||
+       ref_data.samples -> data().size() != ref_streams.size() )
+  {
+    return 0;
+  }
+
+  std::unordered_map<uint64_t, double> ref_samples;
+  for ( size_t i = 0; i < ref_streams.size(); ++i )
+  {
+    ref_samples[ ref_streams[ i ] ] = ref_data.samples -> data()[ i ];
+  }
+
+  streaming_sample_data_t differences;
+  for ( size_t i = 0; i < streams.size(); ++i )
+  {
+    auto it = ref_samples.find( streams[ i ] );
+    if ( it != ref_samples.end() )
+    {
+      differences.add( data.samples -> data()[ i ] - it -> second );
+    }
+  }
+
+  return differences.mean_std_dev();
+}
+
 // Change the player position ( fron/back, etc. ) and update attack hit table
 
 void player_t::change_position( position_e new_pos )
@@ -11407,6 +11478,11 @@ void player_collected_data_t::reserve_memory( const player_t& p )
   heal_taken.reserve( size );
   deaths.reserve( size );
 
+  if ( p.sim -> paired_sampling )
+  {
+    iteration_streams.reserve( size );
+  }
+
   if ( ! p.is_pet() && p.primary_role() == ROLE_TANK )
   {
     theck_meloree_index.reserve( size );
@@ -11425,9 +11501,13 @@ void player_collected_data_t::merge( const player_collected_data_t& other )
   }
 
   total_iterations += other.total_iterations;
+  iteration_streams.insert( iteration_streams.end(), other.iteration_streams.begin(), other.iteration_streams.end() );
 
   fight_length.merge( other.fight_length );
   waiting_time.merge( other.waiting_time );
+  target_metric.merge( other.target_metric );
+  target_metric_moments.merge( other.target_metric_moments );
+  combat_length_metric.merge( other.combat_length_metric );
   executed_foreground_actions.merge( other.executed_foreground_actions );
   // DMG
   dmg.merge( other.dmg );
@@ -11506,6 +11586,7 @@ void player_collected_data_t::analyze( const player_t& p )
   theck_meloree_index.analyze();
   effective_theck_meloree_index.analyze();
   max_spike_amount.analyze();
+  target_metric.analyze();
 
   if ( ! p.sim -> single_actor_batch )
   {
@@ -11641,6 +11722,11 @@ void player_collected_data_t::collect_data( const player_t& p )
   double p_time = p.iteration_pooling_time.total_seconds();
   assert( p.iteration_fight_length <= p.sim -> current_time() );
 
+  if ( p.sim -> paired_sampling )
+  {
+    iteration_streams.push_back( p.sim -> iteration_stream );
+  }
+
   fight_length.add( f_length );
   waiting_time.add( w_time );
   pooling_time.add( p_time );
@@ -11741,7 +11827,7 @@ void player_collected_data_t::collect_data( const player_t& p )
     max_spike_amount.add( max_spike * 100.0 );
   }
 
-  if ( p.sim -> target_error > 0 && ! p.is_pet() && ! p.is_enemy() )
+  if ( ( p.sim -> target_error > 0 || p.sim -> vary_combat_length > 0 ) && ! p.is_pet() && ! p.is_enemy() )
   {
     double metric=0;
 
@@ -11765,10 +11851,23 @@ void player_collected_data_t::collect_data( const player_t& p )
     default:;
     }
 
-    player_collected_data_t& cd = p.parent ? p.parent -> collected_data : *this;
+    if ( p.sim -> target_error > 0 )
+    {
+      target_metric.add( metric );
+      target_metric_moments.add( metric );
+
+      // Publish the running moments for the main thread's convergence checks
+      if ( p.parent && p.parent -> collected_data.thread_target_metric )
+      {
+        p.parent -> collected_data.thread_target_metric[ p.sim -> thread_index ].publish( target_metric_moments );
+      }
+    }
 
-    AUTO_LOCK( cd.target_metric_mutex );
-    cd.target_metric.add( metric );
+    if ( p.sim -> combat_length_sampling != sim_t::LENGTH_SAMPLING_SWEEP &&
+         p.sim -> vary_combat_length > 0 && p.sim -> max_time > timespan_t::zero() )
+    {
+      combat_length_metric.add( p.sim -> expected_iteration_time / p.sim -> max_time, metric );
+    }
   }
 }
 
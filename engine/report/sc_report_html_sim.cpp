@@ -1333,6 +1333,55 @@ void print_nothing_to_report( report::sc_html_stream& os,
      << "</div>\n\n";
 }
 
+/* Print the reports of the actors, each followed by its pets when they are
+ * reported separately. The reports are rendered in parallel, each into its own
+ * buffer with the formatting of os, and written in actor order. Their charts
+ * are captured per actor and added in the same order, so the document is
+ * identical to one printed actor by actor.
+ */
+void print_html_actors( report::sc_html_stream& os, sim_t& sim,
+                        const std::vector<player_t*>& actors, bool targets )
+{
+  struct actor_report_t
+  {
+    std::stringbuf html;
+    sim_t::chart_capture_t charts;
+  };
+
+  std::vector<actor_report_t> reports( actors.size() );
+
+  thread::parallel_for(
+      actors.size(), sim.report_thread_count(),
+      [ &os, &sim, &actors, &reports, targets ]( size_t i ) {
+        report::sc_html_stream actor_os;
+        static_cast<std::ios&>( actor_os ).rdbuf( &reports[ i ].html );
+        actor_os.copyfmt( os );
+
+        sim_t::chart_capture_scope_t capture( reports[ i ].charts );
+
+        // Counter for both players and enemies, without pets.
+        int k = targets ? static_cast<int>( i ) : 0;
+
+        report::print_html_player( actor_os, *actors[ i ], k );
+
+        // Pets
+        if ( sim.report_pets_separately )
+        {
+          for ( auto& pet : actors[ i ]->pet_list )
+          {
+            if ( targets || ( pet->summoned && !pet->quiet ) )
+              report::print_html_player( actor_os, *pet, 1 );
+          }
+        }
+      } );
+
+  for ( const auto& report : reports )
+  {
+    os << report.html.str();
+    report.charts.add_to( sim );
+  }
+}
+
 /* Main function building the html document and calling subfunctions
  */
 void print_html_( report::sc_html_stream& os, sim_t& sim )
@@ -1386,23 +1435,8 @@ void print_html_( report::sc_html_stream& os, sim_t& sim )
     print_html_scale_factors( os, sim );
   }
 
-  int k = 0;  // Counter for both players and enemies, without pets.
-
   // Report Players
-  for ( auto& player : sim.players_by_name )
-  {
-    report::print_html_player( os, *player, k );
-
-    // Pets
-    if ( sim.report_pets_separately )
-    {
-      for ( auto& pet : player->pet_list )
-      {
-        if ( pet->summoned && !pet->quiet )
-          report::print_html_player( os, *pet, 1 );
-      }
-    }
-  }
+  print_html_actors( os, sim, sim.players_by_name, false );
 
   sim.profilesets.output( sim, os );
 
@@ -1414,21 +1448,7 @@ void print_html_( report::sc_html_stream& os, sim_t& sim )
   // Report Targets
   if ( sim.report_targets )
   {
-    for ( auto& player : sim.targets_by_name )
-    {
-      report::print_html_player( os, *player, k );
-      ++k;
-
-      // Pets
-      if ( sim.report_pets_separately )
-      {
-        for ( auto& pet : player->pet_list )
-        {
-          // if ( pet -> summoned )
-          report::print_html_player( os, *pet, 1 );
-        }
-      }
-    }
+    print_html_actors( os, sim, sim.targets_by_name, true );
   }
 
   print_html_help_boxes( os, sim );
@@ -18,6 +18,62 @@ using namespace js;
 
 namespace
 {
+// The json2 report is written through the writer one section at a time. Each section (e.g., the
+// collected data of a player) is generated into its own document, written, and freed, so the
+// report is never held in memory as a whole.
+struct json2_writer_t : public PrettyWriter<FileWriteStream>
+{
+  json2_writer_t( FileWriteStream& os ) : PrettyWriter<FileWriteStream>( os )
+  { }
+
+  // Indentation of the values of the array or object being written
+  std::string indent() const
+  {
+    return std::string( level_stack_.GetSize() / sizeof( Level ) * indentCharCount_, indentChar_ );
+  }
+};
+
+// Actors are written into a buffer of their own, see write_actors()
+using actor_writer_t = PrettyWriter<StringBuffer>;
+
+// Generate a value, and write it
+template <typename Writer, typename F>
+void write_value( Writer& writer, F generate )
+{
+  Document doc;
+  doc.SetObject();
+
+  JsonOutput value( doc, doc );
+  generate( value );
+
+  doc.Accept( writer );
+}
+
+// Generate a value, and write it as a member of the object being written
+template <typename Writer, typename F>
+void write_member( Writer& writer, const char* name, F generate )
+{
+  writer.Key( name );
+  write_value( writer, generate );
+}
+
+// Generate the members of an object, and write them into the object being written
+template <typename Writer, typename F>
+void write_members( Writer& writer, F generate )
+{
+  Document doc;
+  doc.SetObject();
+
+  JsonOutput root( doc, doc );
+  generate( root );
+
+  for ( auto it = doc.MemberBegin(); it != doc.MemberEnd(); ++it )
+  {
+    writer.Key( it -> name.GetString(), it -> name.GetStringLength() );
+    it -> value.Accept( writer );
+  }
+}
+
 double to_json( const timespan_t& t )
 {
   return t.total_seconds();
@@ -424,69 +480,66 @@ js::sc_js_t to_json( const proc_t& p )
   return node;
 }
 
-void stats_to_json( JsonOutput root, const player_t& p )
-{
-  root.make_array();
-
-  range::for_each( p.stats_list, [ & ]( const stats_t* s ) {
-    if ( s -> quiet || s -> num_executes.mean() == 0 )
-    {
-      return;
-    }
+bool has_stats_output( const stats_t* s )
+{ return ! s -> quiet && s -> num_executes.mean() != 0; }
 
-    auto node = root.add();
+void stats_to_json( JsonOutput node, const stats_t* s )
+{
+  node[ "name" ] = s -> name();
+  if ( s -> school != SCHOOL_NONE )
+  {
+    node[ "school" ] = util::school_type_string( s -> school );
+  }
+  node[ "type" ] = util::stats_type_string( s -> type );
 
-    node[ "name" ] = s -> name();
-    if ( s -> school != SCHOOL_NONE )
-    {
-      node[ "school" ] = util::school_type_string( s -> school );
-    }
-    node[ "type" ] = util::stats_type_string( s -> type );
+  if ( has_resources( s -> resource_gain ) )
+  {
+    gain_to_json( node[ "resource_gain" ], s -> resource_gain );
+  }
 
-    if ( has_resources( s -> resource_gain ) )
-    {
-      gain_to_json( node[ "resource_gain" ], s -> resource_gain );
-    }
+  node[ "num_executes" ] = s -> num_executes;
 
-    node[ "num_executes" ] = s -> num_executes;
+  add_non_zero( node, "total_execute_time", s -> total_execute_time );
+  add_non_zero( node, "portion_aps", s -> portion_aps );
+  add_non_zero( node, "portion_apse", s -> portion_apse );
+  add_non_zero( node, "portion_amount", s -> portion_amount );
+  add_non_zero( node, "actual_amount", s -> actual_amount );
+  add_non_zero( node, "total_amount", s -> total_amount );
 
-    add_non_zero( node, "total_execute_time", s -> total_execute_time );
-    add_non_zero( node, "portion_aps", s -> portion_aps );
-    add_non_zero( node, "portion_apse", s -> portion_apse );
-    add_non_zero( node, "portion_amount", s -> portion_amount );
-    add_non_zero( node, "actual_amount", s -> actual_amount );
-    add_non_zero( node, "total_amount", s -> total_amount );
+  if ( s -> num_executes.mean() > 1 )
+  {
+    node[ "total_intervals" ] = s -> total_intervals;
+  }
 
-    if ( s -> num_executes.mean() > 1 )
-    {
-      node[ "total_intervals" ] = s -> total_intervals;
-    }
+  add_non_zero( node, "num_ticks", s -> num_ticks );
+  add_non_zero( node, "num_tick_results", s -> num_tick_results );
+  add_non_zero( node, "total_tick_time", s -> total_tick_time );
+  add_non_zero( node, "num_refreshes", s -> num_refreshes );
 
-    add_non_zero( node, "num_ticks", s -> num_ticks );
-    add_non_zero( node, "num_tick_results", s -> num_tick_results );
-    add_non_zero( node, "total_tick_time", s -> total_tick_time );
-    add_non_zero( node, "num_refreshes", s -> num_refreshes );
+  add_non_zero( node, "num_direct_results", s -> num_direct_results );
 
-    add_non_zero( node, "num_direct_results", s -> num_direct_results );
+  if ( s -> expression_evaluations > 0 )
+  {
+    node[ "expression_evaluations" ] = s -> expression_evaluations;
+  }
 
-    for ( full_result_e r = FULLTYPE_NONE; r < FULLTYPE_MAX; ++r )
+  for ( full_result_e r = FULLTYPE_NONE; r < FULLTYPE_MAX; ++r )
+  {
+    if ( s -> direct_results[ r ].count.mean() != 0 )
     {
-      if ( s -> direct_results[ r ].count.mean() != 0 )
-      {
-        to_json( node[ "direct_results" ][ util::full_result_type_string( r ) ],
-                 s -> direct_results[ r ] );
-      }
+      to_json( node[ "direct_results" ][ util::full_result_type_string( r ) ],
+               s -> direct_results[ r ] );
     }
+  }
 
-    for ( result_e r = RESULT_NONE; r < RESULT_MAX; ++r )
+  for ( result_e r = RESULT_NONE; r < RESULT_MAX; ++r )
+  {
+    if ( s -> tick_results[ r ].count.mean() != 0 )
     {
-      if ( s -> tick_results[ r ].count.mean() != 0 )
-      {
-        to_json( node[ "tick_results" ][ util::result_type_string( r ) ],
-                 s -> tick_results[ r ] );
-      }
+      to_json( node[ "tick_results" ][ util::result_type_string( r ) ],
+               s -> tick_results[ r ] );
     }
-  } );
+  }
 }
 
 void gear_to_json( JsonOutput root, const player_t& p )
@@ -536,6 +589,7 @@ js::sc_js_t to_json( const stats_t& s )
   node.set( "total_amount", to_json( s.total_amount ) );
   node.set( "portion_aps", to_json( s.portion_aps ) );
   node.set( "portion_apse", to_json( s.portion_apse ) );
+  node.set( "expression_evaluations", s.expression_evaluations );
   for ( full_result_e i = FULLTYPE_NONE; i < FULLTYPE_MAX; ++i )
   {
     node.add( "direct_results", to_json( i, s.direct_results[ i ] ) );
@@ -883,6 +937,17 @@ void collected_data_to_json( JsonOutput root, const player_t& p )
     root[ "target_metric" ] = cd.target_metric;
   }
 
+  // Share of the target metric variance coming from the combat length variation
+  if ( cd.combat_length_metric.count() > 1 )
+  {
+    auto node = root[ "combat_length_metric" ];
+
+    node[ "count" ] = as<uint64_t>( cd.combat_length_metric.count() );
+    node[ "mean" ] = cd.combat_length_metric.mean();
+    node[ "variance" ] = cd.combat_length_metric.variance();
+    node[ "explained_variance" ] = cd.combat_length_metric.explained_variance();
+  }
+
   // Key off of resource loss to figure out what resources are even relevant
   std::vector<resource_e> relevant_resources;
   for ( size_t i = 0, end = cd.resource_lost.size(); i < end; ++i )
@@ -1129,9 +1194,6 @@ js::sc_js_t to_json( const player_t& p,
   js::sc_js_t node;
   if ( p.sim->scaling->has_scale_factors() )
   {
-    if ( p.sim->report_precision < 0 )
-      p.sim->report_precision = 2;
-
     scale_metric_e sm      = p.sim->scaling->scaling_metric;
     const gear_stats_t& sf = ( p.sim->scaling->normalize_scale_factors )
                                  ? p.scaling->scaling_normalized[ sm ]
@@ -1151,9 +1213,6 @@ js::sc_js_t to_json( const player_t& p,
 
 void scale_factors_to_json( JsonOutput root, const player_t& p )
 {
-  if ( p.sim -> report_precision < 0 )
-    p.sim -> report_precision = 2;
-
   auto sm = p.sim -> scaling -> scaling_metric;
   const auto& sf = ( p.sim -> scaling -> normalize_scale_factors )
                    ? p.scaling->scaling_normalized[ sm ]
@@ -1170,9 +1229,6 @@ void scale_factors_to_json( JsonOutput root, const player_t& p )
 
 void scale_factors_all_to_json( JsonOutput root, const player_t& p )
 {
-  if ( p.sim -> report_precision < 0 )
-    p.sim -> report_precision = 2;
-
   for ( scale_metric_e sm = SCALE_METRIC_DPS; sm < SCALE_METRIC_MAX; sm++ )
   {
     auto node = root[ util::scale_metric_type_abbrev( sm ) ];
@@ -1217,10 +1273,9 @@ void talents_to_json( JsonOutput root, const player_t& p )
   }
 }
 
-void to_json( JsonOutput& arr, const player_t& p )
+// Player members up to the collected data
+void player_to_json( JsonOutput root, const player_t& p )
 {
-  auto root = arr.add(); // Add a fresh object to the players array and use it as root
-
   root[ "name" ] = p.name();
   root[ "race" ] = util::race_type_string( p.race );
   root[ "level" ] = p.true_level;
@@ -1304,30 +1359,46 @@ void to_json( JsonOutput& arr, const player_t& p )
     scale_factors_to_json( root[ "scale_factors" ], p );
     scale_factors_all_to_json( root[ "scale_factors_all" ], p );
   }
+}
+
+void to_json( actor_writer_t& writer, const player_t& p )
+{
+  writer.StartObject();
 
-  collected_data_to_json( root[ "collected_data" ], p );
+  write_members( writer, [ &p ]( JsonOutput root ) { player_to_json( root, p ); } );
+
+  write_member( writer, "collected_data", [ &p ]( JsonOutput root ) { collected_data_to_json( root, p ); } );
 
   if ( p.sim -> report_details != 0 )
   {
-    buffs_to_json( root[ "buffs" ], p );
+    write_member( writer, "buffs", [ &p ]( JsonOutput root ) { buffs_to_json( root, p ); } );
 
     if ( p.proc_list.size() > 0 )
     {
-      procs_to_json( root[ "procs" ], p );
+      write_member( writer, "procs", [ &p ]( JsonOutput root ) { procs_to_json( root, p ); } );
     }
 
     if ( p.gain_list.size() > 0 )
     {
-      gains_to_json( root[ "gains" ], p );
+      write_member( writer, "gains", [ &p ]( JsonOutput root ) { gains_to_json( root, p ); } );
     }
 
-    stats_to_json( root[ "stats" ], p );
+    writer.Key( "stats" );
+    writer.StartArray();
+    range::for_each( p.stats_list, [ &writer ]( const stats_t* s ) {
+      if ( has_stats_output( s ) )
+      {
+        write_value( writer, [ s ]( JsonOutput node ) { stats_to_json( node, s ); } );
+      }
+    } );
+    writer.EndArray();
   }
 
-  gear_to_json( root[ "gear" ], p );
+  write_member( writer, "gear", [ &p ]( JsonOutput root ) { gear_to_json( root, p ); } );
 
-  JsonOutput custom = root[ "custom" ];
-  p.output_json_report( custom );
+  write_member( writer, "custom", [ &p ]( JsonOutput custom ) { p.output_json_report( custom ); } );
+
+  writer.EndObject();
 }
 
 js::sc_js_t to_json( const player_t& p )
@@ -1536,15 +1607,14 @@ void iteration_data_to_json( JsonOutput root, const std::vector<iteration_data_e
   } );
 }
 
-void to_json( JsonOutput root, const sim_t& sim )
+// Sim-scope options
+void options_to_json( JsonOutput options_root, const sim_t& sim )
 {
-  // Sim-scope options
-  auto options_root = root[ "options" ];
-
   options_root[ "debug" ] = sim.debug;
   options_root[ "max_time" ] = sim.max_time.total_seconds();
   options_root[ "expected_iteration_time" ] = sim.expected_iteration_time.total_seconds();
   options_root[ "vary_combat_length" ] = sim.vary_combat_length;
+  options_root[ "combat_length_sampling" ] = sim.combat_length_sampling_string();
   options_root[ "iterations" ] = sim.iterations;
   options_root[ "target_error" ] = sim.target_error;
   options_root[ "threads" ] = sim.threads;
@@ -1569,6 +1639,7 @@ void to_json( JsonOutput root, const sim_t& sim )
   options_root[ "ignite_sampling_delta" ] =  sim.ignite_sampling_delta;
   options_root[ "fixed_time" ] = sim.fixed_time;
   options_root[ "optimize_expressions" ] = sim.optimize_expressions;
+  options_root[ "compile_expressions" ] = sim.compile_expressions;
   options_root[ "optimal_raid" ] = sim.optimal_raid;
   options_root[ "log" ] = sim.log;
   options_root[ "debug_each" ] = sim.debug_each;
@@ -1584,6 +1655,8 @@ void to_json( JsonOutput root, const sim_t& sim )
   options_root[ "pvp_crit" ] = sim.pvp_crit;
   options_root[ "rng" ] = sim.rng();
   options_root[ "deterministic" ] = sim.deterministic;
+  options_root[ "paired_sampling" ] = sim.paired_sampling;
+  options_root[ "antithetic_sampling" ] = sim.antithetic_sampling;
   options_root[ "average_range" ] = sim.average_range;
   options_root[ "average_gauss" ] = sim.average_gauss;
   options_root[ "fight_style" ] = sim.fight_style;
@@ -1605,9 +1678,10 @@ void to_json( JsonOutput root, const sim_t& sim )
     add_non_zero( scaling_root, "scale_lag", sim.scaling -> scale_lag );
     add_non_zero( scaling_root, "center_scale_delta", sim.scaling -> center_scale_delta );
   }
+}
 
-  // Overrides
-  auto overrides = root[ "overrides" ];
+void overrides_to_json( JsonOutput overrides, const sim_t& sim )
+{
   add_non_zero( overrides, "mortal_wounds", sim.overrides.mortal_wounds );
   add_non_zero( overrides, "bleeding", sim.overrides.bleeding );
   add_non_zero( overrides, "bloodlust", sim.overrides.bloodlust );
@@ -1621,21 +1695,10 @@ void to_json( JsonOutput root, const sim_t& sim )
   {
     overrides[ "target_health" ] = sim.overrides.target_health;
   }
+}
 
-  // Players
-  JsonOutput players_arr = root[ "players" ].make_array();
-
-  range::for_each( sim.player_no_pet_list.data(), [ &players_arr ]( const player_t* p ) {
-    to_json( players_arr, *p );
-  } );
-
-  if ( sim.profilesets.n_profilesets() > 0 )
-  {
-    auto profileset_root = root[ "profilesets" ];
-    sim.profilesets.output( sim, profileset_root );
-  }
-
-  auto stats_root = root[ "statistics" ];
+void statistics_to_json( JsonOutput stats_root, const sim_t& sim )
+{
   stats_root[ "elapsed_cpu_seconds" ] = sim.elapsed_cpu;
   stats_root[ "elapsed_time_seconds" ] = sim.elapsed_time;
   stats_root[ "init_time_seconds" ] = sim.init_time;
@@ -1648,48 +1711,125 @@ void to_json( JsonOutput root, const sim_t& sim )
   add_non_zero( stats_root, "total_dmg", sim.total_dmg );
   add_non_zero( stats_root, "total_heal", sim.total_heal );
   add_non_zero( stats_root, "total_absorb", sim.total_absorb );
+}
 
-  if ( sim.report_details != 0 )
+// Write the actors as an array. The actors are generated in parallel, at most one per thread at a
+// time, each into its own buffer. The buffers are indented to the depth of the array, and written
+// in actor order, so the report is identical to one written actor by actor.
+void write_actors( json2_writer_t& writer, const sim_t& sim, const std::vector<player_t*>& actors )
+{
+  size_t n_threads = sim.report_thread_count();
+  std::vector<StringBuffer> buffers( std::min( n_threads, actors.size() ) );
+
+  writer.StartArray();
+
+  std::string indent = "\n" + writer.indent();
+  std::string json;
+
+  for ( size_t start = 0; start < actors.size(); start += buffers.size() )
   {
-    // Targets
-    JsonOutput targets_arr = root[ "targets" ].make_array();
+    size_t n = std::min( buffers.size(), actors.size() - start );
 
-    range::for_each( sim.target_list.data(), [ &targets_arr ]( const player_t* p ) {
-      to_json( targets_arr, *p );
+    thread::parallel_for( n, as<unsigned>( n ), [ &actors, &buffers, start ]( size_t i ) {
+      buffers[ i ].Clear();
+      actor_writer_t actor_writer( buffers[ i ] );
+      to_json( actor_writer, *actors[ start + i ] );
     } );
 
+    for ( size_t i = 0; i < n; ++i )
+    {
+      // Strings are escaped, all newlines in the buffer are line breaks of the pretty writer
+      json.clear();
+      const char* begin = buffers[ i ].GetString();
+      const char* end = begin + buffers[ i ].GetSize();
+      for ( const char* c = begin; c != end; ++c )
+      {
+        if ( *c == '\n' )
+        {
+          json += indent;
+        }
+        else
+        {
+          json += *c;
+        }
+      }
+
+      writer.RawValue( json.data(), json.size(), kObjectType );
+    }
+  }
+
+  writer.EndArray();
+}
+
+void to_json( json2_writer_t& writer, const sim_t& sim )
+{
+  writer.StartObject();
+
+  write_member( writer, "options", [ &sim ]( JsonOutput root ) { options_to_json( root, sim ); } );
+
+  write_member( writer, "overrides", [ &sim ]( JsonOutput root ) { overrides_to_json( root, sim ); } );
+
+  // Players
+  writer.Key( "players" );
+  write_actors( writer, sim, sim.player_no_pet_list.data() );
+
+  if ( sim.profilesets.n_profilesets() > 0 )
+  {
+    write_member( writer, "profilesets", [ &sim ]( JsonOutput root ) { sim.profilesets.output( sim, root ); } );
+  }
+
+  write_member( writer, "statistics", [ &sim ]( JsonOutput root ) { statistics_to_json( root, sim ); } );
+
+  if ( sim.report_details != 0 )
+  {
+    // Targets
+    writer.Key( "targets" );
+    write_actors( writer, sim, sim.target_list.data() );
+
     // Raid events
     if ( ! sim.raid_events.empty() )
     {
-      auto arr = root[ "raid_events" ].make_array();
+      write_member( writer, "raid_events", [ &sim ]( JsonOutput root ) {
+        root.make_array();
 
-      range::for_each( sim.raid_events, [ &arr ]( const std::unique_ptr<raid_event_t>& event ) {
-        to_json( arr, *event );
+        range::for_each( sim.raid_events, [ &root ]( const std::unique_ptr<raid_event_t>& event ) {
+          to_json( root, *event );
+        } );
       } );
     }
 
     if ( sim.buff_list.size() > 0 )
     {
-      JsonOutput buffs_arr = root[ "sim_auras" ].make_array();
-      range::for_each( sim.buff_list, [ &buffs_arr ]( const buff_t* b ) {
-        if ( b -> avg_start.mean() == 0 )
-        {
-          return;
-        }
-        to_json( buffs_arr.add(), b );
+      write_member( writer, "sim_auras", [ &sim ]( JsonOutput root ) {
+        root.make_array();
+
+        range::for_each( sim.buff_list, [ &root ]( const buff_t* b ) {
+          if ( b -> avg_start.mean() == 0 )
+          {
+            return;
+          }
+          to_json( root.add(), b );
+        } );
       } );
     }
 
-    if ( sim.low_iteration_data.size() > 0 )
+    if ( sim.low_iteration_data.size() > 0 || sim.high_iteration_data.size() > 0 )
     {
-      iteration_data_to_json( root[ "iteration_data" ][ "low" ], sim.low_iteration_data );
-    }
+      write_member( writer, "iteration_data", [ &sim ]( JsonOutput root ) {
+        if ( sim.low_iteration_data.size() > 0 )
+        {
+          iteration_data_to_json( root[ "low" ], sim.low_iteration_data );
+        }
 
-    if ( sim.high_iteration_data.size() > 0 )
-    {
-      iteration_data_to_json( root[ "iteration_data" ][ "high" ], sim.high_iteration_data );
+        if ( sim.high_iteration_data.size() > 0 )
+        {
+          iteration_data_to_json( root[ "high" ], sim.high_iteration_data );
+        }
+      } );
     }
   }
+
+  writer.EndObject();
 }
 
 js::sc_js_t to_json( const sim_t& sim )
@@ -1735,6 +1875,7 @@ js::sc_js_t to_json( const sim_t& sim )
   node.set( "ignite_sampling_delta", to_json( sim.ignite_sampling_delta ) );
   node.set( "fixed_time", sim.fixed_time );
   node.set( "optimize_expressions", sim.optimize_expressions );
+  node.set( "compile_expressions", sim.compile_expressions );
   node.set( "optimal_raid", sim.optimal_raid );
   node.set( "log", sim.log );
   node.set( "debug_each", sim.debug_each );
@@ -1752,6 +1893,8 @@ js::sc_js_t to_json( const sim_t& sim )
   node.set( "rng", to_json( sim.rng() ) );
   node.set( "rng_seed", sim.seed );
   node.set( "deterministic", sim.deterministic );
+  node.set( "paired_sampling", sim.paired_sampling );
+  node.set( "antithetic_sampling", sim.antithetic_sampling );
   node.set( "average_range", sim.average_range );
   node.set( "average_gauss", sim.average_gauss );
   for ( const auto& re : sim.raid_events )
@@ -1822,34 +1965,34 @@ js::sc_js_t get_root( const sim_t& sim )
 
 void print_json2_pretty( FILE* o, const sim_t& sim )
 {
-  Document doc;
-  Value& v = doc;
-  v.SetObject();
+  std::array<char, 1024000> buffer;
+  FileWriteStream b( o, buffer.data(), buffer.size() );
+  json2_writer_t writer( b );
 
-  JsonOutput root( doc, v );
+  writer.StartObject();
 
-  root[ "version" ] = SC_VERSION;
-  root[ "ptr_enabled" ] = SC_USE_PTR;
-  root[ "beta_enabled" ] = SC_BETA;
-  root[ "build_date" ] = __DATE__;
-  root[ "build_time" ] = __TIME__;
-  if ( git_info::available())
-  {
-    root[ "git_revision" ] = git_info::revision();
-    root[ "git_branch" ] = git_info::branch();
-  }
+  write_members( writer, []( JsonOutput root ) {
+    root[ "version" ] = SC_VERSION;
+    root[ "ptr_enabled" ] = SC_USE_PTR;
+    root[ "beta_enabled" ] = SC_BETA;
+    root[ "build_date" ] = __DATE__;
+    root[ "build_time" ] = __TIME__;
+    if ( git_info::available())
+    {
+      root[ "git_revision" ] = git_info::revision();
+      root[ "git_branch" ] = git_info::branch();
+    }
+  } );
 
-  to_json( root[ "sim" ], sim );
+  writer.Key( "sim" );
+  to_json( writer, sim );
 
   if ( sim.error_list.size() > 0 )
   {
-    root[ "notifications" ] = sim.error_list;
+    write_members( writer, [ &sim ]( JsonOutput root ) { root[ "notifications" ] = sim.error_list; } );
   }
 
-  std::array<char, 1024000> buffer;
-  FileWriteStream b( o, buffer.data(), buffer.size() );
-  PrettyWriter<FileWriteStream> writer( b );
-  doc.Accept( writer );
+  writer.EndObject();
 }
 
 void print_json_pretty( FILE* o, const sim_t& sim )
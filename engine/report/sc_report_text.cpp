@@ -5,10 +5,29 @@
 
 #include "sc_report.hpp"
 #include "simulationcraft.hpp"
+#if defined( __GNUG__ )
+#include <cxxabi.h>
+#endif
 
 namespace
 {  // UNNAMED NAMESPACE ==========================================
 
+// Readable name of a type from typeid(), demangled on compilers that mangle it
+std::string demangle_type_name( const char* name )
+{
+#if defined( __GNUG__ )
+  int status = 0;
+  char* demangled = abi::__cxa_demangle( name, nullptr, nullptr, &status );
+  if ( status == 0 && demangled )
+  {
+    std::string str = demangled;
+    std::free( demangled );
+    return str;
+  }
+#endif
+  return name;
+}
+
 void simplify_html( std::string& buffer )
 {
   util::replace_all( buffer, "&lt;", "<" );
@@ -745,6 +764,7 @@ void print_text_performance( FILE* file, sim_t* sim )
   std::strftime( date_str, sizeof date_str, "%Y-%m-%d %H:%M:%S%z",
                  std::localtime( &cur_time ) );
   std::stringstream iterations_str;
+  std::stringstream wait_str;
   if ( sim -> threads > 1 )
   {
     iterations_str << " (";
@@ -758,20 +778,47 @@ void print_text_performance( FILE* file, sim_t* sim )
       }
     }
     iterations_str << ")";
+
+    wait_str << "\n  WaitSeconds   = (";
+    for ( size_t i = 0; i < sim -> wait_time_per_thread.size(); ++i )
+    {
+      wait_str << util::to_string( sim -> wait_time_per_thread[ i ], 3 );
+
+      if ( i < sim -> wait_time_per_thread.size() - 1 )
+      {
+        wait_str << ", ";
+      }
+    }
+    wait_str << ")";
+  }
+
+#ifdef EVENT_QUEUE_DEBUG
+  // Traversal cost of the hierarchical wheel is the number of events moved
+  // between levels
+  unsigned long long n_cascaded = 0, n_overflow = 0;
+  if ( sim->event_mgr.hierarchical_wheel )
+  {
+    n_cascaded = sim->event_mgr.hierarchical_wheel->n_cascaded;
+    n_overflow = sim->event_mgr.hierarchical_wheel->n_overflow;
   }
+#endif
 
   util::fprintf(
       file,
       "\nBaseline Performance:\n"
       "  RNG Engine    = %s%s\n"
-      "  Iterations    = %d%s\n"
+      "  Iterations    = %d%s%s\n"
+      "  EventQueue    = %s\n"
       "  TotalEvents   = %lu\n"
       "  MaxEventQueue = %lu\n"
+      "  FnEventAllocs = %lu\n"
 #ifdef EVENT_QUEUE_DEBUG
       "  AllocEvents   = %u\n"
       "  EndInsert     = %u (%.3f%%)\n"
       "  MaxTravDepth  = %u\n"
       "  AvgTravDepth  = %.3f\n"
+      "  Cascaded      = %llu (%.3f per event)\n"
+      "  OverflowIns   = %llu\n"
 #endif
       "  TargetHealth  = %.0f\n"
       "  SimSeconds    = %.0f\n"
@@ -785,8 +832,11 @@ void print_text_performance( FILE* file, sim_t* sim )
       sim->rng().name(), sim->deterministic ? " (deterministic)" : "",
       sim->iterations,
       sim -> threads > 1 ? iterations_str.str().c_str() : "",
+      sim -> threads > 1 ? wait_str.str().c_str() : "",
+      sim->event_mgr.queue_type_name(),
       sim->event_mgr.total_events_processed,
       sim->event_mgr.max_events_remaining,
+      sim->event_mgr.fn_heap_allocations,
 #ifdef EVENT_QUEUE_DEBUG
       sim->event_mgr.n_allocated_events, sim->event_mgr.n_end_insert,
       100.0 * static_cast<double>( sim->event_mgr.n_end_insert ) /
@@ -794,6 +844,9 @@ void print_text_performance( FILE* file, sim_t* sim )
       sim->event_mgr.max_queue_depth,
       static_cast<double>( sim->event_mgr.events_traversed ) /
           sim->event_mgr.events_added,
+      n_cascaded,
+      static_cast<double>( n_cascaded ) / sim->event_mgr.events_added,
+      n_overflow,
 #endif
       sim->target->resources.base[ RESOURCE_HEALTH ],
       sim->iterations * sim->simulation_length.mean(), sim->elapsed_cpu,
@@ -803,6 +856,45 @@ void print_text_performance( FILE* file, sim_t* sim )
       sim->analyze_time,
       sim->iterations * sim->simulation_length.mean() / sim->elapsed_cpu,
       date_str, static_cast<double>( cur_time ) );
+
+  util::fprintf( file, "Event Memory:\n" );
+  for ( const auto& c : sim->event_mgr.slab_classes )
+  {
+    size_t n_slabs = c.slabs.size() + c.merged_slabs;
+    util::fprintf( file, "  Size: %-5u Slabs: %-5u Bytes: %u\n",
+                   static_cast<unsigned>( c.size ), static_cast<unsigned>( n_slabs ),
+                   static_cast<unsigned>( n_slabs * c.slab_bytes() ) );
+  }
+  for ( size_t i = 0; i < sim->event_memory_per_thread.size(); ++i )
+  {
+    util::fprintf( file, "  Thread: %-3u Bytes: %u\n", static_cast<unsigned>( i ),
+                   static_cast<unsigned>( sim->event_memory_per_thread[ i ] ) );
+  }
+  util::fprintf( file, "\n" );
+
+  // Function event callables too large to be stored in the event, by callable type. Lambda type
+  // names include the function creating them.
+  if ( ! sim->event_mgr.fn_heap_sites.empty() )
+  {
+    using site_t = std::pair<const char*, event_manager_t::fn_heap_site_t>;
+    std::vector<site_t> sites( sim->event_mgr.fn_heap_sites.begin(), sim->event_mgr.fn_heap_sites.end() );
+    range::sort( sites, []( const site_t& l, const site_t& r ) {
+      if ( l.second.count != r.second.count )
+        return l.second.count > r.second.count;
+      return std::strcmp( l.first, r.first ) < 0;
+    } );
+
+    util::fprintf( file, "Heap Function Events:\n" );
+    for ( const auto& site : sites )
+    {
+      util::fprintf( file, "  Count: %-8llu Size: %-5u %s\n",
+                     static_cast<unsigned long long>( site.second.count ),
+                     static_cast<unsigned>( site.second.size ),
+                     demangle_type_name( site.first ).c_str() );
+    }
+    util::fprintf( file, "\n" );
+  }
+
 #ifdef EVENT_QUEUE_DEBUG
   double total_p = 0;
 
@@ -853,10 +945,63 @@ void print_text_performance( FILE* file, sim_t* sim )
 
   util::fprintf( file, "Total: %.3f%% Alloc Samples: %llu\n", total_p,
                  sim->event_mgr.n_requested_events );
-  util::fprintf( file, "Alloc size used for event_t: %u\n", util::next_power_of_two( 2 * sizeof( event_t ) ) );
 #endif
 }
 
+// print_text_http ==========================================================
+
+/* Item and character import requests of the http cache. */
+void print_text_http( FILE* file )
+{
+  http::statistics_t stats = http::statistics();
+  if ( stats.requests == 0 )
+    return;
+
+  util::fprintf( file,
+                 "HTTP Requests: %u (hits=%u downloads=%u shared=%u failures=%u) "
+                 "Downloaded=%.1fkB DownloadTime=%.3fs\n\n",
+                 stats.requests, stats.hits, stats.downloads, stats.shared, stats.failures,
+                 stats.bytes / 1024.0, stats.download_time );
+}
+
+// print_text_combat_length_sampling ========================================
+
+/* Share of the target metric variance coming from the combat length variation,
+ * and the resulting error of the mean with plain (independent) and stratified
+ * combat length sampling. */
+void print_text_combat_length_sampling( FILE* file, sim_t* sim )
+{
+  if ( sim->combat_length_sampling == sim_t::LENGTH_SAMPLING_SWEEP ||
+       sim->vary_combat_length <= 0 )
+    return;
+
+  bool header = false;
+
+  for ( const auto& p : sim->players_by_name )
+  {
+    const auto& cd = p->collected_data.combat_length_metric;
+    if ( cd.count() < 2 || cd.mean() == 0 )
+      continue;
+
+    if ( !header )
+    {
+      util::fprintf( file, "Combat Length Sampling: %s (vary_combat_length=%.2f)\n",
+                     sim->combat_length_sampling_string(), sim->vary_combat_length );
+      header = true;
+    }
+
+    double plain_error = sim->confidence_estimator * std::sqrt( cd.variance() / cd.count() ) / cd.mean();
+    double stratified_error = plain_error * std::sqrt( 1.0 - cd.explained_variance() );
+
+    util::fprintf( file, "  %-20s Explained=%.1f%% Error(plain)=%.3f%% Error(stratified)=%.3f%%\n",
+                   p->name(), 100.0 * cd.explained_variance(), 100.0 * plain_error,
+                   100.0 * stratified_error );
+  }
+
+  if ( header )
+    util::fprintf( file, "\n" );
+}
+
 // print_text_scale_factors =================================================
 
 void print_text_scale_factors( FILE* file, sim_t* sim )
@@ -1341,6 +1486,8 @@ void print_text_report( FILE* file, sim_t* sim, bool detail )
   sim -> profilesets.output( *sim, file );
 
   print_text_performance( file, sim );
+  print_text_combat_length_sampling( file, sim );
+  print_text_http( file );
 
   if ( detail )
   {
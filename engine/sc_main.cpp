@@ -61,26 +61,27 @@ struct sim_signal_handler_t
     fflush( stderr );
   }
 
-  static void sigint( int signal )
+  // Only flag the request, the simulator threads cancel or interrupt the simulation. Canceling
+  // locks mutexes and joins the profileset init threads, which is not safe in a signal handler.
+  static void sigint( int )
   {
     if ( global_sim )
     {
-      report( signal );
       if( global_sim -> scaling -> calculate_scale_factors || global_sim -> reforge_plot -> current_reforge_sim || global_sim -> plot -> current_plot_stat != STAT_NONE )
       {
-        global_sim -> cancel();
+        global_sim -> cancel_requested = true;
       }
       else if ( global_sim -> single_actor_batch )
       {
-        global_sim -> cancel();
+        global_sim -> cancel_requested = true;
       }
       else if ( ! global_sim -> profileset_map.empty() )
       {
-        global_sim -> cancel();
+        global_sim -> cancel_requested = true;
       }
       else
       {
-        global_sim -> interrupt();
+        global_sim -> interrupt_requested = true;
       }
     }
   }
@@ -320,6 +321,8 @@ int sim_t::main( const std::vector<std::string>& args )
       else
       {
         report::print_suite( this );
+
+        checkpoint.finish();
       }
     }
     else
@@ -327,6 +330,12 @@ int sim_t::main( const std::vector<std::string>& args )
       util::printf("Simulation was canceled.\n");
       canceled = 1;
     }
+
+    // Keep the work completed before the cancel for checkpoint_resume
+    if ( canceled )
+    {
+      checkpoint.save();
+    }
   }
 
   std::cout << std::endl;
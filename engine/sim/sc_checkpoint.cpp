@@ -0,0 +1,249 @@
+// ==========================================================================
+// Dedmonwakeen's Raid DPS/TPS Simulator.
+// Send questions to natehieter@gmail.com
+// ==========================================================================
+
+#include <cstdio>
+
+#include "simulationcraft.hpp"
+#include "sc_checkpoint.hpp"
+#include "util/git_info.hpp"
+
+namespace checkpoint
+{
+namespace
+{
+// 64-bit FNV-1a
+void hash_string( uint64_t& hash, const std::string& str )
+{
+  for ( auto c : str )
+  {
+    hash = ( hash ^ static_cast<unsigned char>( c ) ) * 1099511628211ULL;
+  }
+  hash = ( hash ^ 0xff ) * 1099511628211ULL;
+}
+} /* Namespace anonymous ends */
+
+uint64_t options_key( const sim_control_t* control )
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  hash_string( hash, SC_VERSION );
+  if ( git_info::available() )
+  {
+    hash_string( hash, git_info::revision() );
+  }
+
+  return options_key( control -> options, hash );
+}
+
+uint64_t options_key( const std::vector<option_tuple_t>& options, uint64_t key )
+{
+  static const std::vector<std::string> report_opts {
+    "output", "html", "xml", "json", "json2", "report_progress", "profileset_cache_file",
+    "checkpoint_file", "checkpoint_interval", "checkpoint_resume"
+  };
+
+  range::for_each( options, [ &key ]( const option_tuple_t& opt ) {
+    if ( range::find( report_opts, opt.name ) != report_opts.end() )
+    {
+      return;
+    }
+
+    hash_string( key, opt.scope );
+    hash_string( key, opt.name );
+    hash_string( key, opt.value );
+  } );
+
+  return key;
+}
+
+std::string checkpoint_t::entry_key( const std::string& section, const std::string& key )
+{
+  assert( section.find( ' ' ) == std::string::npos && key.find( ' ' ) == std::string::npos );
+
+  return section + " " + key;
+}
+
+bool checkpoint_t::is_enabled() const
+{
+  return ! m_sim -> checkpoint_file.empty() && ! m_sim -> parent;
+}
+
+void checkpoint_t::init()
+{
+  if ( ! is_enabled() )
+  {
+    return;
+  }
+
+  std::stringstream s;
+  s << SC_VERSION << " " << std::hex << options_key( m_sim -> control );
+  m_header = s.str();
+
+  m_last_save = util::wall_time();
+
+  if ( m_sim -> checkpoint_resume )
+  {
+    load();
+  }
+}
+
+// Load the entries of an earlier run. A checkpoint of different options or simulator version is
+// ignored.
+void checkpoint_t::load()
+{
+  io::ifstream file;
+  file.open( m_sim -> checkpoint_file );
+  if ( ! file.is_open() )
+  {
+    return;
+  }
+
+  std::string line;
+  if ( ! std::getline( file, line ) || line != m_header )
+  {
+    m_sim -> errorf( "Checkpoint '%s' is from a different simulation, not resuming",
+      m_sim -> checkpoint_file.c_str() );
+    return;
+  }
+
+  while ( std::getline( file, line ) )
+  {
+    // "<section> <key> <values ...>"
+    auto key_end = line.find( ' ', line.find( ' ' ) + 1 );
+    if ( key_end == std::string::npos )
+    {
+      continue;
+    }
+
+    m_entries[ line.substr( 0, key_end ) ] = line.substr( key_end + 1 );
+  }
+
+  m_resumed = m_entries.size();
+
+  if ( m_resumed > 0 )
+  {
+    std::cout << "Resuming " << m_resumed << " completed work items from checkpoint '"
+              << m_sim -> checkpoint_file << "'" << std::endl;
+  }
+}
+
+std::vector<double> checkpoint_t::find( const std::string& section, const std::string& key )
+{
+  std::vector<double> values;
+
+  if ( ! is_enabled() )
+  {
+    return values;
+  }
+
+  std::lock_guard<std::mutex> lock( m_mutex );
+
+  auto it = m_entries.find( entry_key( section, key ) );
+  if ( it == m_entries.end() )
+  {
+    return values;
+  }
+
+  std::istringstream s( it -> second );
+  double v;
+  while ( s >> v )
+  {
+    values.push_back( v );
+  }
+
+  return values;
+}
+
+void checkpoint_t::add( const std::string& section, const std::string& key, const std::vector<double>& values )
+{
+  if ( ! is_enabled() )
+  {
+    return;
+  }
+
+  std::ostringstream s;
+  s.precision( std::numeric_limits<double>::max_digits10 );
+  for ( size_t i = 0; i < values.size(); ++i )
+  {
+    s << ( i > 0 ? " " : "" ) << values[ i ];
+  }
+
+  std::lock_guard<std::mutex> lock( m_mutex );
+
+  m_entries[ entry_key( section, key ) ] = s.str();
+
+  if ( util::wall_time() - m_last_save >= m_sim -> checkpoint_interval )
+  {
+    save_file();
+  }
+}
+
+void checkpoint_t::save()
+{
+  if ( ! is_enabled() )
+  {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock( m_mutex );
+
+  // Not initialized, do not replace the checkpoint of an earlier run with an empty one
+  if ( m_header.empty() )
+  {
+    return;
+  }
+
+  save_file();
+}
+
+// Write the checkpoint to a temporary file first, so that an interruption while writing leaves the
+// previous checkpoint intact. Note, we must own the mutex here.
+void checkpoint_t::save_file()
+{
+  m_last_save = util::wall_time();
+
+  auto tmp_file = m_sim -> checkpoint_file + ".tmp";
+
+  {
+    io::ofstream file;
+    file.open( tmp_file );
+    if ( ! file.is_open() )
+    {
+      m_sim -> errorf( "Unable to write checkpoint '%s'", tmp_file.c_str() );
+      return;
+    }
+
+    file << m_header << '\n';
+    for ( const auto& entry : m_entries )
+    {
+      file << entry.first << ' ' << entry.second << '\n';
+    }
+  }
+
+  if ( std::rename( tmp_file.c_str(), m_sim -> checkpoint_file.c_str() ) != 0 )
+  {
+    // Renaming over an existing file fails on some platforms
+    std::remove( m_sim -> checkpoint_file.c_str() );
+    std::rename( tmp_file.c_str(), m_sim -> checkpoint_file.c_str() );
+  }
+}
+
+void checkpoint_t::finish()
+{
+  if ( ! is_enabled() || m_sim -> canceled )
+  {
+    return;
+  }
+
+  std::remove( m_sim -> checkpoint_file.c_str() );
+}
+
+void create_options( sim_t* sim )
+{
+  sim -> add_option( opt_string( "checkpoint_file", sim -> checkpoint_file ) );
+  sim -> add_option( opt_float( "checkpoint_interval", sim -> checkpoint_interval, 0, std::numeric_limits<double>::max() ) );
+  sim -> add_option( opt_bool( "checkpoint_resume", sim -> checkpoint_resume ) );
+}
+} /* Namespace checkpoint ends */
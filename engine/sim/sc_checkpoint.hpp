@@ -0,0 +1,75 @@
+// ==========================================================================
+// Dedmonwakeen's Raid DPS/TPS Simulator.
+// Send questions to natehieter@gmail.com
+// ==========================================================================
+#ifndef SC_CHECKPOINT_HPP
+#define SC_CHECKPOINT_HPP
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct sim_t;
+struct sim_control_t;
+struct option_tuple_t;
+
+namespace checkpoint
+{
+// Checkpointing of completed work of long simulations (scale factor stats, profilesets). Work
+// items are stored as "<section> <key>" entries, with whitespace-separated values, and written to
+// checkpoint_file every checkpoint_interval seconds. With checkpoint_resume, the entries of an
+// earlier, interrupted run of the same options are loaded, and the work they cover is skipped.
+class checkpoint_t
+{
+  using entry_map_t = std::map<std::string, std::string>;
+
+  sim_t*      m_sim;
+  std::mutex  m_mutex;
+  std::string m_header;
+  entry_map_t m_entries;
+  size_t      m_resumed;
+  double      m_last_save;
+
+  static std::string entry_key( const std::string& section, const std::string& key );
+
+  void load();
+  void save_file();
+
+public:
+  checkpoint_t( sim_t* sim ) : m_sim( sim ), m_resumed( 0 ), m_last_save( 0 )
+  { }
+
+  bool is_enabled() const;
+
+  // Number of entries resumed from an earlier run
+  size_t resumed() const
+  { return m_resumed; }
+
+  void init();
+
+  // Values of a work item completed by an earlier run, or an empty vector
+  std::vector<double> find( const std::string& section, const std::string& key );
+
+  // Record a completed work item, and write the checkpoint if checkpoint_interval has passed
+  void add( const std::string& section, const std::string& key, const std::vector<double>& values );
+
+  // Write the checkpoint now
+  void save();
+
+  // The simulation finished, the checkpoint is no longer needed
+  void finish();
+};
+
+void create_options( sim_t* sim );
+
+// Key identifying a simulation by its options and the simulator version. Options that only control
+// reporting are ignored.
+uint64_t options_key( const sim_control_t* control );
+
+// Key of the options, continuing from the key of the options preceding them
+uint64_t options_key( const std::vector<option_tuple_t>& options, uint64_t key );
+} /* Namespace checkpoint ends */
+
+#endif /* SC_CHECKPOINT_HPP */
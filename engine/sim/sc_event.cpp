@@ -4,6 +4,9 @@
 // ==========================================================================
 
 #include "simulationcraft.hpp"
+#if defined( SC_VS )
+#include <intrin.h>
+#endif
 
 // ==========================================================================
 // Event
@@ -79,6 +82,261 @@ void event_t::cancel( event_t*& e )
   e           = nullptr;
 }
 
+// ==========================================================================
+// Hierarchical Timing Wheel
+// ==========================================================================
+
+namespace {
+
+// Index of the lowest set bit of a non-zero 64-bit value
+unsigned lowest_bit( uint64_t v )
+{
+  assert( v != 0 );
+#if defined( SC_VS )
+  unsigned long index;
+#  if defined( _WIN64 )
+  _BitScanForward64( &index, v );
+#  else
+  if ( static_cast<uint32_t>( v ) )
+    _BitScanForward( &index, static_cast<uint32_t>( v ) );
+  else
+  {
+    _BitScanForward( &index, static_cast<uint32_t>( v >> 32 ) );
+    index += 32;
+  }
+#  endif
+  return static_cast<unsigned>( index );
+#else
+  return static_cast<unsigned>( __builtin_ctzll( v ) );
+#endif
+}
+
+} // unnamed namespace
+
+event_manager_t::hierarchical_wheel_t::hierarchical_wheel_t()
+#ifdef EVENT_QUEUE_DEBUG
+  : n_cascaded( 0 ),
+    n_overflow( 0 )
+#endif /* EVENT_QUEUE_DEBUG */
+{
+  clear();
+}
+
+// hierarchical_wheel_t::clear ==============================================
+
+void event_manager_t::hierarchical_wheel_t::clear()
+{
+  for ( unsigned level = 0; level < LEVELS; ++level )
+  {
+    for ( unsigned slot = 0; slot < SLOTS; ++slot )
+    {
+      head[ level ][ slot ] = nullptr;
+      tail[ level ][ slot ] = nullptr;
+    }
+    occupied[ level ] = 0;
+  }
+
+  overflow      = nullptr;
+  overflow_tail = nullptr;
+  now           = 0;
+}
+
+// hierarchical_wheel_t::append =============================================
+
+void event_manager_t::hierarchical_wheel_t::append( unsigned level, unsigned slot, event_t* e )
+{
+  e->next = nullptr;
+  if ( tail[ level ][ slot ] )
+  {
+    tail[ level ][ slot ]->next = e;
+  }
+  else
+  {
+    head[ level ][ slot ] = e;
+    occupied[ level ] |= uint64_t( 1 ) << slot;
+  }
+  tail[ level ][ slot ] = e;
+}
+
+// hierarchical_wheel_t::insert =============================================
+
+void event_manager_t::hierarchical_wheel_t::insert( event_t* e )
+{
+  // Only valid for integer based timespan_t
+  uint64_t t = static_cast<uint64_t>( e->time.total_millis() );
+  assert( t >= now );
+
+  // The event belongs to the lowest level on which the rest of its timestamp
+  // matches the cursor.
+  uint64_t diff = t ^ now;
+  unsigned level = 0;
+  while ( level < LEVELS && ( diff >> ( SLOT_BITS * ( level + 1 ) ) ) != 0 )
+  {
+    level++;
+  }
+
+  if ( level == LEVELS )
+  {
+#ifdef EVENT_QUEUE_DEBUG
+    n_overflow++;
+#endif /* EVENT_QUEUE_DEBUG */
+    e->next = nullptr;
+    if ( overflow_tail )
+      overflow_tail->next = e;
+    else
+      overflow = e;
+    overflow_tail = e;
+    return;
+  }
+
+  append( level, static_cast<unsigned>( ( t >> ( SLOT_BITS * level ) ) & ( SLOTS - 1 ) ), e );
+}
+
+// hierarchical_wheel_t::cascade ============================================
+
+void event_manager_t::hierarchical_wheel_t::cascade( unsigned level, unsigned slot )
+{
+  event_t* e = head[ level ][ slot ];
+  head[ level ][ slot ] = nullptr;
+  tail[ level ][ slot ] = nullptr;
+  occupied[ level ] &= ~( uint64_t( 1 ) << slot );
+
+  // Re-insert in list order, so events with equal timestamps stay in FIFO order
+  while ( e )
+  {
+    event_t* next = e->next;
+    insert( e );
+    e = next;
+#ifdef EVENT_QUEUE_DEBUG
+    n_cascaded++;
+#endif /* EVENT_QUEUE_DEBUG */
+  }
+}
+
+// hierarchical_wheel_t::cascade_overflow ===================================
+
+void event_manager_t::hierarchical_wheel_t::cascade_overflow()
+{
+  // All levels are empty, so the cursor can jump straight to the earliest
+  // overflowed event.
+  uint64_t min_time = std::numeric_limits<uint64_t>::max();
+  for ( event_t* e = overflow; e; e = e->next )
+  {
+    min_time = std::min( min_time, static_cast<uint64_t>( e->time.total_millis() ) );
+  }
+
+  event_t* e    = overflow;
+  overflow      = nullptr;
+  overflow_tail = nullptr;
+  now           = min_time;
+
+  while ( e )
+  {
+    event_t* next = e->next;
+    insert( e );
+    e = next;
+#ifdef EVENT_QUEUE_DEBUG
+    n_cascaded++;
+#endif /* EVENT_QUEUE_DEBUG */
+  }
+}
+
+// hierarchical_wheel_t::pop ================================================
+
+event_t* event_manager_t::hierarchical_wheel_t::pop()
+{
+  while ( true )
+  {
+    unsigned slot = static_cast<unsigned>( now & ( SLOTS - 1 ) );
+    if ( event_t* e = head[ 0 ][ slot ] )
+    {
+      head[ 0 ][ slot ] = e->next;
+      if ( !e->next )
+      {
+        tail[ 0 ][ slot ] = nullptr;
+        occupied[ 0 ] &= ~( uint64_t( 1 ) << slot );
+      }
+      return e;
+    }
+
+    // Advance the cursor to the next occupied slot, starting from the lowest
+    // level. The slot under the cursor is always empty on every level, so the
+    // search can include it.
+    unsigned level = 0;
+    for ( ; level < LEVELS; ++level )
+    {
+      unsigned shift   = SLOT_BITS * level;
+      unsigned index   = static_cast<unsigned>( ( now >> shift ) & ( SLOTS - 1 ) );
+      uint64_t pending = occupied[ level ] & ( ~uint64_t( 0 ) << index );
+      if ( pending )
+      {
+        unsigned next = lowest_bit( pending );
+        now = ( now & ~( ( uint64_t( 1 ) << ( shift + SLOT_BITS ) ) - 1 ) ) |
+              ( uint64_t( next ) << shift );
+        if ( level > 0 )
+        {
+          cascade( level, next );
+        }
+        break;
+      }
+    }
+
+    if ( level == LEVELS )
+    {
+      if ( !overflow )
+      {
+        return nullptr;
+      }
+      cascade_overflow();
+    }
+  }
+}
+
+// ==========================================================================
+// Event Allocator
+// ==========================================================================
+
+namespace {
+
+// Block header, large enough to keep the event payload suitably aligned
+const std::size_t SLAB_HEADER_SIZE = 16;
+// Target size of a single slab
+const std::size_t SLAB_SIZE = 16384;
+
+std::size_t& block_class( event_t* e )
+{
+  return *reinterpret_cast<std::size_t*>( reinterpret_cast<char*>( e ) - SLAB_HEADER_SIZE );
+}
+
+// Smallest size class, fitting a bare event_t
+std::size_t min_slab_class_size()
+{
+  static const std::size_t SIZE = util::next_power_of_two( sizeof( event_t ) );
+  return SIZE;
+}
+
+} // unnamed namespace
+
+event_manager_t::slab_class_t::slab_class_t( std::size_t s )
+  : size( s ),
+    blocks_per_slab( std::max( std::size_t( 1 ), SLAB_SIZE / ( s + SLAB_HEADER_SIZE ) ) ),
+    slab_used( 0 ),
+    slabs(),
+    free_list( nullptr ),
+    merged_slabs( 0 )
+{
+}
+
+std::size_t event_manager_t::slab_class_t::stride() const
+{
+  return size + SLAB_HEADER_SIZE;
+}
+
+std::size_t event_manager_t::slab_class_t::slab_bytes() const
+{
+  return stride() * blocks_per_slab;
+}
+
 // ==========================================================================
 // Event Manager
 // ==========================================================================
@@ -91,17 +349,21 @@ event_manager_t::event_manager_t( sim_t* s )
     events_processed( 0 ),
     total_events_processed( 0 ),
     max_events_remaining( 0 ),
+    fn_heap_allocations( 0 ),
+    fn_heap_sites(),
     timing_slice( 0 ),
     global_event_id( 1 ),  // start at 1, so we can identify event -> id == 0
                            // meaning a unscheduled event.
     timing_wheel(),
-    recycled_event_list( nullptr ),
+    slab_classes(),
     wheel_seconds( 0 ),
     wheel_size( 0 ),
     wheel_mask( 0 ),
     wheel_shift( 5 ),
     wheel_granularity( 0.0 ),
     wheel_time( timespan_t::zero() ),
+    queue_type( QUEUE_WHEEL ),
+    hierarchical_wheel(),
     event_stopwatch( STOPWATCH_THREAD ),
 #ifdef EVENT_QUEUE_DEBUG
     monitor_cpu( false ),
@@ -116,18 +378,18 @@ event_manager_t::event_manager_t( sim_t* s )
     canceled( false )
 #endif /* EVENT_QUEUE_DEBUG */
 {
-  allocated_events.reserve( 100 );
 }
 
 // event_manager_t::~event_manager_t ========================================
 
 event_manager_t::~event_manager_t()
 {
-  while ( recycled_event_list )
+  for ( auto& c : slab_classes )
   {
-    event_t* e          = recycled_event_list;
-    recycled_event_list = e->next;
-    free( e );
+    for ( auto slab : c.slabs )
+    {
+      free( slab );
+    }
   }
 }
 
@@ -135,11 +397,21 @@ event_manager_t::~event_manager_t()
 
 void* event_manager_t::allocate_event( const std::size_t size )
 {
-  static const std::size_t SIZE = util::next_power_of_two( 2 * sizeof( event_t ) );
-  assert( SIZE > size );
-  (void)size;
+  // Size classes are successive powers of two, starting from the size of a
+  // bare event_t
+  std::size_t index = 0;
+  for ( std::size_t class_size = min_slab_class_size(); class_size < size; class_size *= 2 )
+  {
+    index++;
+  }
+
+  while ( index >= slab_classes.size() )
+  {
+    slab_classes.push_back( slab_class_t( min_slab_class_size() << slab_classes.size() ) );
+  }
+
+  slab_class_t& c = slab_classes[ index ];
 
-  event_t* e = recycled_event_list;
 #ifdef EVENT_QUEUE_DEBUG
   n_requested_events++;
   if ( size >= event_requested_size_count.size() )
@@ -148,26 +420,30 @@ void* event_manager_t::allocate_event( const std::size_t size )
   }
   event_requested_size_count[ size ]++;
 #endif
-  if ( e )
+  if ( event_t* e = c.free_list )
   {
-    recycled_event_list = e->next;
+    c.free_list = e->next;
+    return e;
   }
-  else
-  {
-    e = (event_t*)malloc( SIZE );
 
-    if ( !e )
+  if ( c.slabs.empty() || c.slab_used == c.blocks_per_slab )
+  {
+    char* slab = static_cast<char*>( malloc( c.slab_bytes() ) );
+    if ( !slab )
     {
       throw std::bad_alloc();
     }
-    else
-    {
+
+    c.slabs.push_back( slab );
+    c.slab_used = 0;
+  }
+
 #ifdef EVENT_QUEUE_DEBUG
-      n_allocated_events++;
+  n_allocated_events++;
 #endif
-      allocated_events.push_back( e );
-    }
-  }
+  event_t* e = reinterpret_cast<event_t*>( c.slabs.back() + c.slab_used++ * c.stride() +
+                                           SLAB_HEADER_SIZE );
+  block_class( e ) = index;
 
   return e;
 }
@@ -176,10 +452,36 @@ void* event_manager_t::allocate_event( const std::size_t size )
 
 void event_manager_t::recycle_event( event_t* e )
 {
+  slab_class_t& c = slab_classes[ block_class( e ) ];
+
   e->~event_t();
-  e->recycled         = true;
-  e->next             = recycled_event_list;
-  recycled_event_list = e;
+  e->recycled = true;
+  e->next     = c.free_list;
+  c.free_list = e;
+}
+
+// event_manager_t::record_fn_heap_allocation ===============================
+
+void event_manager_t::record_fn_heap_allocation( const char* type_name, std::size_t size )
+{
+  fn_heap_allocations++;
+
+  auto& site = fn_heap_sites[ type_name ];
+  site.size = size;
+  site.count++;
+}
+
+// event_manager_t::allocated_bytes =========================================
+
+std::size_t event_manager_t::allocated_bytes() const
+{
+  std::size_t bytes = 0;
+  for ( const auto& c : slab_classes )
+  {
+    bytes += c.slabs.size() * c.slab_bytes();
+  }
+
+  return bytes;
 }
 
 // event_manager_t::add_event ===============================================
@@ -192,6 +494,50 @@ void event_manager_t::add_event( event_t* e, timespan_t delta_time )
   if ( delta_time < timespan_t::zero() )
     delta_time = timespan_t::zero();
 
+  if ( queue_type == QUEUE_HIERARCHICAL )
+  {
+    e->time            = current_time + delta_time;
+    e->reschedule_time = timespan_t::zero();
+
+    hierarchical_wheel->insert( e );
+#ifdef EVENT_QUEUE_DEBUG
+    // Insertion never traverses other events
+    events_added++;
+    if ( event_queue_depth_samples.empty() )
+    {
+      event_queue_depth_samples.resize( 1 );
+    }
+    event_queue_depth_samples[ 0 ].first++;
+    event_queue_depth_samples[ 0 ].second++;
+#endif
+  }
+  else
+  {
+    add_event_wheel( e, delta_time );
+  }
+
+  if ( ++events_remaining > max_events_remaining )
+    max_events_remaining = events_remaining;
+
+  if ( sim->debug )
+    sim->out_debug.printf( "Add Event: %s time=%.4f rs-time=%.4f id=%d",
+                           e->name(), e->time.total_seconds(),
+                           e->reschedule_time.total_seconds(), e->id );
+
+#if ACTOR_EVENT_BOOKKEEPING
+  if ( sim->debug && e->actor )
+  {
+    e->actor->event_counter++;
+    sim->out_debug.printf( "Actor %s has %d scheduled events", e->actor->name(),
+                           e->actor->event_counter );
+  }
+#endif
+}
+
+// event_manager_t::add_event_wheel =========================================
+
+void event_manager_t::add_event_wheel( event_t* e, timespan_t delta_time )
+{
   if ( delta_time > wheel_time )
   {
     e->time = current_time + wheel_time - timespan_t::from_seconds( 1 );
@@ -246,23 +592,6 @@ void event_manager_t::add_event( event_t* e, timespan_t delta_time )
   // insert event
   e->next = *prev;
   *prev   = e;
-
-  if ( ++events_remaining > max_events_remaining )
-    max_events_remaining = events_remaining;
-
-  if ( sim->debug )
-    sim->out_debug.printf( "Add Event: %s time=%.4f rs-time=%.4f id=%d",
-                           e->name(), e->time.total_seconds(),
-                           e->reschedule_time.total_seconds(), e->id );
-
-#if ACTOR_EVENT_BOOKKEEPING
-  if ( sim->debug && e->actor )
-  {
-    e->actor->event_counter++;
-    sim->out_debug.printf( "Actor %s has %d scheduled events", e->actor->name(),
-                           e->actor->event_counter );
-  }
-#endif
 }
 
 // event_manager_t::reschedule_event ========================================
@@ -363,17 +692,31 @@ void event_manager_t::cancel()
 
 void event_manager_t::flush()
 {
-  for ( auto e : allocated_events )
+  for ( auto& c : slab_classes )
   {
-    if ( e->recycled )
-      continue;
-    event_t* null_e = e;  // necessary evil
-    event_t::cancel( null_e );
-    recycle_event( e );
+    for ( size_t i = 0; i < c.slabs.size(); ++i )
+    {
+      // Only the most recent slab can be partially carved
+      size_t n_blocks = i + 1 < c.slabs.size() ? c.blocks_per_slab : c.slab_used;
+      for ( size_t j = 0; j < n_blocks; ++j )
+      {
+        event_t* e = reinterpret_cast<event_t*>( c.slabs[ i ] + j * c.stride() + SLAB_HEADER_SIZE );
+        if ( e->recycled )
+          continue;
+        event_t* null_e = e;  // necessary evil
+        event_t::cancel( null_e );
+        recycle_event( e );
+      }
+    }
   }
 
   // Clear Timing Wheel
   timing_wheel.assign( timing_wheel.size(), nullptr );
+
+  if ( hierarchical_wheel )
+  {
+    hierarchical_wheel->clear();
+  }
 }
 
 // event_manager_t::init ====================================================
@@ -405,6 +748,11 @@ void event_manager_t::init()
   // The timing wheel represents an array of event lists: Each time slice has an
   // event list.
   timing_wheel.resize( wheel_size );
+
+  if ( queue_type == QUEUE_HIERARCHICAL )
+  {
+    hierarchical_wheel = std::unique_ptr<hierarchical_wheel_t>( new hierarchical_wheel_t() );
+  }
 }
 
 // event_manager_t::next_event ==============================================
@@ -414,6 +762,15 @@ event_t* event_manager_t::next_event()
   if ( events_remaining == 0 )
     return nullptr;
 
+  if ( queue_type == QUEUE_HIERARCHICAL )
+  {
+    event_t* e = hierarchical_wheel->pop();
+    assert( e );
+    events_remaining--;
+    events_processed++;
+    return e;
+  }
+
   while ( true )
   {
     event_t*& event_list = timing_wheel[ timing_slice ];
@@ -447,6 +804,11 @@ void event_manager_t::reset()
   global_event_id  = 0;
   canceled         = false;
   current_time     = timespan_t::zero();
+
+  if ( hierarchical_wheel )
+  {
+    hierarchical_wheel->now = 0;
+  }
 }
 
 // event_manager_t::merge ===================================================
@@ -456,6 +818,24 @@ void event_manager_t::merge( event_manager_t& other )
   max_events_remaining =
       std::max( max_events_remaining, other.max_events_remaining );
   total_events_processed += other.total_events_processed;
+  fn_heap_allocations += other.fn_heap_allocations;
+  for ( const auto& entry : other.fn_heap_sites )
+  {
+    auto& site = fn_heap_sites[ entry.first ];
+    site.size = entry.second.size;
+    site.count += entry.second.count;
+  }
+
+  while ( slab_classes.size() < other.slab_classes.size() )
+  {
+    slab_classes.push_back( slab_class_t( min_slab_class_size() << slab_classes.size() ) );
+  }
+
+  for ( size_t i = 0; i < other.slab_classes.size(); ++i )
+  {
+    slab_classes[ i ].merged_slabs +=
+        other.slab_classes[ i ].slabs.size() + other.slab_classes[ i ].merged_slabs;
+  }
 #ifdef EVENT_QUEUE_DEBUG
   events_traversed += other.events_traversed;
   events_added += other.events_added;
@@ -485,5 +865,23 @@ void event_manager_t::merge( event_manager_t& other )
     event_requested_size_count[ i ] += other.event_requested_size_count[ i ];
   }
 
+  if ( hierarchical_wheel && other.hierarchical_wheel )
+  {
+    hierarchical_wheel->n_cascaded += other.hierarchical_wheel->n_cascaded;
+    hierarchical_wheel->n_overflow += other.hierarchical_wheel->n_overflow;
+  }
 #endif
 }
+
+// event_manager_t::queue_type_name =========================================
+
+const char* event_manager_t::queue_type_name() const
+{
+  switch ( queue_type )
+  {
+    case QUEUE_HIERARCHICAL:
+      return "hierarchical";
+    default:
+      return "wheel";
+  }
+}
@@ -15,22 +15,31 @@ namespace
 const bool EXPRESSION_DEBUG = false;
 // Unary Operators ==========================================================
 
-template <class F>
-class expr_unary_t : public expr_t
+class unary_base_t : public expr_t
 {
+public:
   expr_t* input;
 
-public:
-  expr_unary_t( const std::string& n, token_e o, expr_t* i )
+  unary_base_t( const std::string& n, token_e o, expr_t* i )
     : expr_t( n, o ), input( i )
   {
     assert( input );
   }
 
-  ~expr_unary_t()
+  ~unary_base_t()
   {
     delete input;
   }
+};
+
+template <class F>
+class expr_unary_t : public unary_base_t
+{
+public:
+  expr_unary_t( const std::string& n, token_e o, expr_t* i )
+    : unary_base_t( n, o, i )
+  {
+  }
 
   double evaluate() override  // override
   {
@@ -187,6 +196,26 @@ public:
   }
 };
 
+// Binary operator with one operand reduced to a constant by optimization
+class reduced_binary_base_t : public expr_t
+{
+public:
+  expr_t* operand;
+  double constant;
+  bool constant_left;
+
+  reduced_binary_base_t( const std::string& n, token_e o, expr_t* e, double c, bool cl )
+    : expr_t( n, o ), operand( e ), constant( c ), constant_left( cl )
+  {
+    assert( operand );
+  }
+
+  ~reduced_binary_base_t()
+  {
+    delete operand;
+  }
+};
+
 expr_t* select_binary( const std::string& name, token_e op, expr_t* left,
                        expr_t* right )
 {
@@ -726,20 +755,16 @@ public:
       if ( EXPRESSION_DEBUG )
         printf( "Reduced %*d %s (%s) binary expression left\n", spacing, id(),
                 name(), left->name() );
-      struct left_reduced_t : public expr_t
+      struct left_reduced_t : public reduced_binary_base_t
       {
-        double left;
-        expr_t* right;
         left_reduced_t( const std::string& n, token_e o, double l, expr_t* r )
-          : expr_t( n, o ), left( l ), right( r )
+          : reduced_binary_base_t( n, o, r, l, true )
         {
         }
         double evaluate() override
         {
-          return F<double>()( left, right->eval() );
+          return F<double>()( constant, operand->eval() );
         }
-        ~left_reduced_t()
-        { delete right; }
       };
       expr_t* reduced = new left_reduced_t(
           std::string( name() ) + "_left_reduced('" + left->name() + "')", op_,
@@ -753,20 +778,16 @@ public:
       if ( EXPRESSION_DEBUG )
         printf( "Reduced %*d %s (%s) binary expression right\n", spacing, id(),
                 name(), right->name() );
-      struct right_reduced_t : public expr_t
+      struct right_reduced_t : public reduced_binary_base_t
       {
-        expr_t* left;
-        double right;
         right_reduced_t( const std::string& n, token_e o, expr_t* l, double r )
-          : expr_t( n, o ), left( l ), right( r )
+          : reduced_binary_base_t( n, o, l, r, false )
         {
         }
         double evaluate() override
         {
-          return F<double>()( left->eval(), right );
+          return F<double>()( operand->eval(), constant );
         }
-        ~right_reduced_t()
-        { delete left; }
       };
       expr_t* reduced = new right_reduced_t(
           std::string( name() ) + "_right_reduced('" + right->name() + "')",
@@ -830,6 +851,515 @@ expr_t* select_analyze_binary( const std::string& name, token_e op,
   }
 }
 
+// Compiled Expressions =====================================================
+
+namespace compiled
+{
+struct instruction_t;
+
+typedef const instruction_t* ( *exec_fn )( const instruction_t*, double*& );
+
+/**
+ * Instruction of a compiled expression. Each instruction carries the function
+ * executing it, which returns the next instruction to execute.
+ */
+struct instruction_t
+{
+  exec_fn exec;
+  double value;  // Constant operand
+  union
+  {
+    const void* ref;  // Typed leaf
+    expr_t* expr;     // Leaf evaluated through a virtual call
+  };
+  size_t target;  // Jump target index while compiling
+  const instruction_t* jump;
+
+  instruction_t( exec_fn fn, double v = 0 ) : exec( fn ), value( v ), ref( nullptr ), target( 0 ), jump( nullptr )
+  {
+  }
+};
+
+// Forms of binary instructions, by where the operands come from
+enum binary_form_e
+{
+  FORM_STACK,
+  FORM_LEFT_CONST,
+  FORM_RIGHT_CONST,
+  FORM_CALL_LEFT_CONST,
+  FORM_CALL_RIGHT_CONST,
+  FORM_LOAD_LEFT_CONST,
+  FORM_LOAD_RIGHT_CONST
+};
+
+struct logical_xor
+{
+  double operator()( double l, double r ) const
+  {
+    return ( l != 0 ) != ( r != 0 );
+  }
+};
+
+const instruction_t* push_const( const instruction_t* ip, double*& sp )
+{
+  *sp++ = ip->value;
+  return ip + 1;
+}
+
+const instruction_t* call( const instruction_t* ip, double*& sp )
+{
+  *sp++ = ip->expr->eval();
+  return ip + 1;
+}
+
+template <typename T>
+const instruction_t* load( const instruction_t* ip, double*& sp )
+{
+  *sp++ = expr_t::coerce( *static_cast<const T*>( ip->ref ) );
+  return ip + 1;
+}
+
+const instruction_t* to_bool( const instruction_t* ip, double*& sp )
+{
+  sp[ -1 ] = sp[ -1 ] != 0;
+  return ip + 1;
+}
+
+// Leave false and jump past the right side, otherwise continue with the right side
+const instruction_t* and_jump( const instruction_t* ip, double*& sp )
+{
+  if ( sp[ -1 ] == 0 )
+  {
+    sp[ -1 ] = 0;
+    return ip->jump;
+  }
+  --sp;
+  return ip + 1;
+}
+
+// Leave true and jump past the right side, otherwise continue with the right side
+const instruction_t* or_jump( const instruction_t* ip, double*& sp )
+{
+  if ( sp[ -1 ] != 0 )
+  {
+    sp[ -1 ] = 1;
+    return ip->jump;
+  }
+  --sp;
+  return ip + 1;
+}
+
+template <typename F>
+const instruction_t* unary( const instruction_t* ip, double*& sp )
+{
+  sp[ -1 ] = F()( sp[ -1 ] );
+  return ip + 1;
+}
+
+template <typename F>
+const instruction_t* binary_stack( const instruction_t* ip, double*& sp )
+{
+  sp[ -2 ] = F()( sp[ -2 ], sp[ -1 ] );
+  --sp;
+  return ip + 1;
+}
+
+template <typename F>
+const instruction_t* binary_left_const( const instruction_t* ip, double*& sp )
+{
+  sp[ -1 ] = F()( ip->value, sp[ -1 ] );
+  return ip + 1;
+}
+
+template <typename F>
+const instruction_t* binary_right_const( const instruction_t* ip, double*& sp )
+{
+  sp[ -1 ] = F()( sp[ -1 ], ip->value );
+  return ip + 1;
+}
+
+template <typename F>
+const instruction_t* call_left_const( const instruction_t* ip, double*& sp )
+{
+  *sp++ = F()( ip->value, ip->expr->eval() );
+  return ip + 1;
+}
+
+template <typename F>
+const instruction_t* call_right_const( const instruction_t* ip, double*& sp )
+{
+  *sp++ = F()( ip->expr->eval(), ip->value );
+  return ip + 1;
+}
+
+template <typename T, typename F>
+const instruction_t* load_left_const( const instruction_t* ip, double*& sp )
+{
+  *sp++ = F()( ip->value, expr_t::coerce( *static_cast<const T*>( ip->ref ) ) );
+  return ip + 1;
+}
+
+template <typename T, typename F>
+const instruction_t* load_right_const( const instruction_t* ip, double*& sp )
+{
+  *sp++ = F()( expr_t::coerce( *static_cast<const T*>( ip->ref ) ), ip->value );
+  return ip + 1;
+}
+
+// Typed leaves, identified by the load instruction reading them
+template <typename F>
+exec_fn load_binary( exec_fn load_fn, bool left_const )
+{
+  if ( load_fn == &load<double> )
+    return left_const ? &load_left_const<double, F> : &load_right_const<double, F>;
+  if ( load_fn == &load<int> )
+    return left_const ? &load_left_const<int, F> : &load_right_const<int, F>;
+  if ( load_fn == &load<unsigned> )
+    return left_const ? &load_left_const<unsigned, F> : &load_right_const<unsigned, F>;
+  if ( load_fn == &load<bool> )
+    return left_const ? &load_left_const<bool, F> : &load_right_const<bool, F>;
+  if ( load_fn == &load<timespan_t> )
+    return left_const ? &load_left_const<timespan_t, F> : &load_right_const<timespan_t, F>;
+
+  assert( false );
+  return nullptr;
+}
+
+template <typename F>
+exec_fn binary_fn( binary_form_e form, exec_fn load_fn )
+{
+  switch ( form )
+  {
+    case FORM_LEFT_CONST:       return &binary_left_const<F>;
+    case FORM_RIGHT_CONST:      return &binary_right_const<F>;
+    case FORM_CALL_LEFT_CONST:  return &call_left_const<F>;
+    case FORM_CALL_RIGHT_CONST: return &call_right_const<F>;
+    case FORM_LOAD_LEFT_CONST:  return load_binary<F>( load_fn, true );
+    case FORM_LOAD_RIGHT_CONST: return load_binary<F>( load_fn, false );
+    default:                    return &binary_stack<F>;
+  }
+}
+
+exec_fn binary_fn( token_e op, binary_form_e form, exec_fn load_fn = nullptr )
+{
+  switch ( op )
+  {
+    case TOK_ADD:   return binary_fn<std::plus<double>>( form, load_fn );
+    case TOK_SUB:   return binary_fn<std::minus<double>>( form, load_fn );
+    case TOK_MULT:  return binary_fn<std::multiplies<double>>( form, load_fn );
+    case TOK_DIV:   return binary_fn<std::divides<double>>( form, load_fn );
+    case TOK_MAX:   return binary_fn<binary::max<double>>( form, load_fn );
+    case TOK_MIN:   return binary_fn<binary::min<double>>( form, load_fn );
+    case TOK_EQ:    return binary_fn<std::equal_to<double>>( form, load_fn );
+    case TOK_NOTEQ: return binary_fn<std::not_equal_to<double>>( form, load_fn );
+    case TOK_LT:    return binary_fn<std::less<double>>( form, load_fn );
+    case TOK_LTEQ:  return binary_fn<std::less_equal<double>>( form, load_fn );
+    case TOK_GT:    return binary_fn<std::greater<double>>( form, load_fn );
+    case TOK_GTEQ:  return binary_fn<std::greater_equal<double>>( form, load_fn );
+    case TOK_XOR:   return binary_fn<logical_xor>( form, load_fn );
+    default:
+      assert( false );
+      return nullptr;
+  }
+}
+
+exec_fn unary_fn( token_e op )
+{
+  switch ( op )
+  {
+    case TOK_MINUS: return &unary<std::negate<double>>;
+    case TOK_NOT:   return &unary<std::logical_not<double>>;
+    case TOK_ABS:   return &unary<unary::abs>;
+    case TOK_FLOOR: return &unary<unary::floor>;
+    case TOK_CEIL:  return &unary<unary::ceil>;
+    default:
+      assert( false );
+      return nullptr;
+  }
+}
+
+double apply_unary( token_e op, double v )
+{
+  double* sp = &v + 1;
+  instruction_t i( unary_fn( op ) );
+  i.exec( &i, sp );
+  return v;
+}
+
+double apply_binary( token_e op, double l, double r )
+{
+  double v = l;
+  double* sp = &v + 1;
+  instruction_t i( binary_fn( op, FORM_RIGHT_CONST ), r );
+  i.exec( &i, sp );
+  return v;
+}
+
+/**
+ * Flat program compiled from an (optimized) expression tree. Operator nodes
+ * become instructions executed on a value stack, reference expressions become
+ * typed loads and any other expression stays a leaf evaluated through a virtual
+ * call. Comparisons of a leaf with a constant are fused into one instruction,
+ * and logical and/or jump past their right side once the result is decided.
+ * The compiled expression owns the original tree, which keeps the leaves alive.
+ * The value stack is local to evaluate(), so leaves may evaluate the same
+ * expression again (reentrancy), and programs deeper than MAX_DEPTH are not
+ * used.
+ */
+class compiled_expr_t : public expr_t
+{
+public:
+  static const int MAX_DEPTH = 64;
+
+private:
+  // Result of compiling a subtree. Constant subtrees emit no code.
+  struct result_t
+  {
+    bool constant;
+    double value;
+    size_t start;  // First instruction of the subtree
+  };
+
+  expr_t* tree;
+  std::vector<instruction_t> program;
+  int depth, max_depth;
+
+  void emit( const instruction_t& i, int stack_change )
+  {
+    program.push_back( i );
+    depth += stack_change;
+    max_depth = std::max( max_depth, depth );
+  }
+
+  result_t constant( double value ) const
+  {
+    return { true, value, program.size() };
+  }
+
+  // Is the subtree compiled from start a single leaf instruction
+  bool single_leaf( const result_t& r, exec_fn fn ) const
+  {
+    return !r.constant && r.start + 1 == program.size() && program[ r.start ].exec == fn;
+  }
+
+  bool single_load( const result_t& r ) const
+  {
+    return single_leaf( r, &load<double> ) || single_leaf( r, &load<int> ) ||
+           single_leaf( r, &load<unsigned> ) || single_leaf( r, &load<bool> ) ||
+           single_leaf( r, &load<timespan_t> );
+  }
+
+  template <typename T>
+  bool compile_load( expr_t* e )
+  {
+    if ( auto ref = dynamic_cast<ref_expr_t<T>*>( e ) )
+    {
+      instruction_t i( &load<T> );
+      i.ref = &ref->reference();
+      emit( i, 1 );
+      return true;
+    }
+
+    return false;
+  }
+
+  result_t compile_leaf( expr_t* e )
+  {
+    result_t r = { false, 0, program.size() };
+
+    double value;
+    if ( e->is_constant( &value ) )
+      return constant( value );
+
+    if ( compile_load<double>( e ) || compile_load<int>( e ) || compile_load<unsigned>( e ) ||
+         compile_load<bool>( e ) || compile_load<timespan_t>( e ) )
+    {
+      return r;
+    }
+
+    instruction_t i( &call );
+    i.expr = e;
+    emit( i, 1 );
+    return r;
+  }
+
+  result_t compile_unary( token_e op, expr_t* input )
+  {
+    result_t r = compile_node( input );
+    if ( r.constant )
+      return constant( apply_unary( op, r.value ) );
+
+    emit( instruction_t( unary_fn( op ) ), 0 );
+    return r;
+  }
+
+  // Short-circuiting logical and/or
+  result_t compile_logical( token_e op, expr_t* left, expr_t* right )
+  {
+    // The left side value deciding the result
+    bool decided = op == TOK_OR;
+    result_t l = compile_node( left );
+    if ( l.constant && ( l.value != 0 ) == decided )
+      return constant( decided );
+
+    if ( !l.constant && program.back().exec == &to_bool )
+    {
+      // The jump only tests the left side for zero, so a nested logical on the left does not need
+      // to normalize its result. Its jumps now land on this jump instead.
+      program.pop_back();
+      for ( auto& i : program )
+      {
+        if ( i.target == program.size() + 1 )
+          i.target = program.size();
+      }
+    }
+
+    size_t jump = program.size();
+    if ( !l.constant )
+      emit( instruction_t( op == TOK_AND ? &and_jump : &or_jump ), -1 );
+
+    result_t r = compile_node( right );
+    if ( r.constant && l.constant )
+      return constant( r.value != 0 );
+    if ( r.constant )
+      emit( instruction_t( &push_const, r.value ), 1 );
+    emit( instruction_t( &to_bool ), 0 );
+
+    if ( !l.constant )
+      program[ jump ].target = program.size();
+
+    return { false, 0, l.constant ? r.start : l.start };
+  }
+
+  result_t compile_binary( token_e op, const result_t& l, const result_t& r )
+  {
+    if ( l.constant && r.constant )
+      return constant( apply_binary( op, l.value, r.value ) );
+
+    if ( l.constant || r.constant )
+    {
+      const result_t& operand = l.constant ? r : l;
+      double value = l.constant ? l.value : r.value;
+      binary_form_e form = l.constant ? FORM_LEFT_CONST : FORM_RIGHT_CONST;
+      if ( single_leaf( operand, &call ) )
+      {
+        // Fuse the leaf into the operator
+        program[ operand.start ].exec = binary_fn( op, l.constant ? FORM_CALL_LEFT_CONST : FORM_CALL_RIGHT_CONST );
+        program[ operand.start ].value = value;
+      }
+      else if ( single_load( operand ) )
+      {
+        program[ operand.start ].exec = binary_fn( op, l.constant ? FORM_LOAD_LEFT_CONST : FORM_LOAD_RIGHT_CONST,
+                                                   program[ operand.start ].exec );
+        program[ operand.start ].value = value;
+      }
+      else
+      {
+        emit( instruction_t( binary_fn( op, form ), value ), 0 );
+      }
+
+      return operand;
+    }
+
+    emit( instruction_t( binary_fn( op, FORM_STACK ) ), -1 );
+    return l;
+  }
+
+  result_t compile_node( expr_t* e )
+  {
+    if ( auto unary = dynamic_cast<unary_base_t*>( e ) )
+      return compile_unary( unary->op_, unary->input );
+
+    if ( auto binary = dynamic_cast<binary_base_t*>( e ) )
+    {
+      if ( binary->op_ == TOK_AND || binary->op_ == TOK_OR )
+        return compile_logical( binary->op_, binary->left, binary->right );
+
+      result_t l = compile_node( binary->left );
+      result_t r = compile_node( binary->right );
+      return compile_binary( binary->op_, l, r );
+    }
+
+    if ( auto reduced = dynamic_cast<reduced_binary_base_t*>( e ) )
+    {
+      result_t c = constant( reduced->constant );
+      result_t operand = compile_node( reduced->operand );
+      return reduced->constant_left ? compile_binary( reduced->op_, c, operand )
+                                    : compile_binary( reduced->op_, operand, c );
+    }
+
+    return compile_leaf( e );
+  }
+
+public:
+  compiled_expr_t( expr_t* e )
+    : expr_t( e->name(), e->op_ ), tree( e ), depth( 0 ), max_depth( 0 )
+  {
+    result_t r = compile_node( tree );
+    if ( r.constant )
+      emit( instruction_t( &push_const, r.value ), 1 );
+    assert( depth == 1 );
+
+    for ( auto& i : program )
+    {
+      if ( i.exec != &and_jump && i.exec != &or_jump )
+        continue;
+
+      // A decided and/or landing on a jump of the same kind is decided there too
+      while ( i.target < program.size() && program[ i.target ].exec == i.exec )
+        i.target = program[ i.target ].target;
+      i.jump = program.data() + i.target;
+    }
+  }
+
+  ~compiled_expr_t()
+  {
+    delete tree;
+  }
+
+  bool is_constant( double* v ) override
+  {
+    if ( program.size() != 1 || program[ 0 ].exec != &push_const )
+      return false;
+
+    *v = program[ 0 ].value;
+    return true;
+  }
+
+  // The whole program is a single virtual call of the root expression
+  bool single_call() const
+  {
+    return program.size() == 1 && program[ 0 ].exec == &call;
+  }
+
+  // The program needs more stack than evaluate() has
+  bool too_deep() const
+  {
+    return max_depth > MAX_DEPTH;
+  }
+
+  expr_t* release_tree()
+  {
+    expr_t* e = tree;
+    tree = nullptr;
+    return e;
+  }
+
+  double evaluate() override
+  {
+    double stack[ MAX_DEPTH ];
+    double* sp = stack;
+    const instruction_t* ip = program.data();
+    const instruction_t* end = ip + program.size();
+    while ( ip != end )
+      ip = ip->exec( ip, sp );
+
+    return stack[ 0 ];
+  }
+};
+
+} // compiled
+
 }  // UNNAMED NAMESPACE ====================================================
 
 // precedence ===============================================================
@@ -1347,6 +1877,33 @@ expr_t* expr_t::parse( action_t* action, const std::string& expr_str,
   return nullptr;
 }
 
+// expr_t::compile ==========================================================
+
+expr_t* expr_t::compile( expr_t* e )
+{
+  if ( !e )
+    return e;
+
+  auto compiled = new expression::compiled::compiled_expr_t( e );
+
+  double value;
+  if ( compiled->is_constant( &value ) )
+  {
+    std::string name = std::string( "const_compiled('" ) + e->name() + "')";
+    delete compiled;
+    return new const_expr_t( name, value );
+  }
+
+  if ( compiled->single_call() || compiled->too_deep() )
+  {
+    e = compiled->release_tree();
+    delete compiled;
+    return e;
+  }
+
+  return compiled;
+}
+
 #ifdef UNIT_TEST
 
 uint32_t dbc::get_school_mask( school_e )
@@ -139,6 +139,8 @@ public:
 
   static expr_t* parse( action_t*, const std::string& expr_str,
                         bool optimize = false );
+  /// Compile an expression tree into flat bytecode, taking ownership of the tree
+  static expr_t* compile( expr_t* );
   template<class T>
   static expr_t* create_constant( const std::string& name, T value );
 
@@ -197,6 +199,11 @@ public:
   {
   }
 
+  const T& reference() const
+  {
+    return t;
+  }
+
 private:
   const T& t;
   virtual double evaluate() override
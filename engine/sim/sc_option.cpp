@@ -431,6 +431,10 @@ protected:
           stream << name() << entry.first << "="<< entry.second << "\n";
      return stream;
   }
+public:
+  bool prefix_match() const override
+  { return true; }
+protected:
   opts::map_t& _ref;
 };
 
@@ -497,6 +501,10 @@ protected:
     return stream;
   }
 
+public:
+  bool prefix_match() const override
+  { return true; }
+protected:
   opts::map_list_t& _ref;
 };
 
@@ -576,6 +584,83 @@ bool opts::parse( sim_t*                 sim,
   return false;
 }
 
+// index_t::build ===========================================================
+
+void opts::index_t::build( const std::vector<std::unique_ptr<option_t>>& options )
+{
+  m_names.clear();
+  m_prefixes.clear();
+
+  for ( size_t i = 0; i < options.size(); ++i )
+  {
+    position_map_t& map = options[ i ] -> prefix_match() ? m_prefixes : m_names;
+    map[ options[ i ] -> name() ].push_back( i );
+  }
+
+  m_size = options.size();
+}
+
+// index_t::parse ===========================================================
+
+bool opts::index_t::parse( sim_t*                 sim,
+                           const std::vector<std::unique_ptr<option_t>>& options,
+                           const std::string&     name,
+                           const std::string&     value )
+{
+  if ( m_size != options.size() || ( m_names.empty() && m_prefixes.empty() ) )
+  {
+    build( options );
+  }
+
+  static const std::vector<size_t> none;
+
+  auto name_it = m_names.find( name );
+  const std::vector<size_t>& named = name_it != m_names.end() ? name_it -> second : none;
+
+  // Prefix options parse "<prefix>.<key>" and "<prefix>.<key>+"
+  const std::vector<size_t>* prefixed = &none;
+  if ( ! m_prefixes.empty() && ! name.empty() )
+  {
+    std::string::size_type last = name.size() - 1;
+    if ( name[ last ] == '+' && last > 0 )
+    {
+      --last;
+    }
+
+    std::string::size_type dot = name.rfind( '.', last );
+    if ( dot != std::string::npos )
+    {
+      auto prefix_it = m_prefixes.find( name.substr( 0, dot + 1 ) );
+      if ( prefix_it != m_prefixes.end() )
+      {
+        prefixed = &prefix_it -> second;
+      }
+    }
+  }
+
+  // Merge the two candidate lists in vector order
+  auto n = named.begin(), p = prefixed -> begin();
+  while ( n != named.end() || p != prefixed -> end() )
+  {
+    size_t position;
+    if ( p == prefixed -> end() || ( n != named.end() && *n < *p ) )
+    {
+      position = *n++;
+    }
+    else
+    {
+      position = *p++;
+    }
+
+    if ( options[ position ] -> parse_option( sim, name, value ) )
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 // option_t::parse ==========================================================
 
 void opts::parse( sim_t*                 sim,
@@ -903,3 +988,57 @@ std::unique_ptr<option_t> opt_func( const std::string& n, const opts::function_t
 
 std::unique_ptr<option_t> opt_deprecated( const std::string& n, const std::string& new_option )
 { return std::unique_ptr<option_t>(new opts_deperecated_t( n, new_option )); }
+
+#ifdef UNIT_TEST
+
+#include <chrono>
+
+// Parse a 10k line profile of 5 options per line against a sim-sized option vector, linearly and
+// with the name index, and check that both give the same values.
+int main( int, char** )
+{
+  const size_t n_options = 500, n_lines = 10000, n_tokens = 5;
+
+  std::vector<std::string> linear_values( n_options ), index_values( n_options );
+  opts::map_t linear_map, index_map;
+
+  std::vector<std::unique_ptr<option_t>> linear_options, index_options;
+  for ( size_t i = 0; i < n_options; ++i )
+  {
+    linear_options.push_back( opt_string( "option_" + util::to_string( i ), linear_values[ i ] ) );
+    index_options.push_back( opt_string( "option_" + util::to_string( i ), index_values[ i ] ) );
+  }
+  linear_options.push_back( opt_map( "map.", linear_map ) );
+  index_options.push_back( opt_map( "map.", index_map ) );
+
+  std::vector<std::pair<std::string, std::string>> tokens;
+  for ( size_t i = 0; i < n_lines * n_tokens; ++i )
+  {
+    std::string name = i % 7 == 0 ? "map.key_" + util::to_string( i % 13 ) : "option_" + util::to_string( ( i * 7919 ) % n_options );
+    tokens.push_back( std::make_pair( name, util::to_string( i ) ) );
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for ( const auto& token : tokens )
+  {
+    opts::parse( nullptr, linear_options, token.first, token.second );
+  }
+  std::chrono::duration<double> linear_time = std::chrono::steady_clock::now() - start;
+
+  opts::index_t index;
+  start = std::chrono::steady_clock::now();
+  for ( const auto& token : tokens )
+  {
+    index.parse( nullptr, index_options, token.first, token.second );
+  }
+  std::chrono::duration<double> index_time = std::chrono::steady_clock::now() - start;
+
+  bool same = linear_values == index_values && linear_map == index_map;
+
+  std::cout << n_lines << " lines, " << tokens.size() << " options: linear " << linear_time.count()
+            << "s, indexed " << index_time.count() << "s, " << ( same ? "same" : "DIFFERENT" ) << " values\n";
+
+  return same ? 0 : 1;
+}
+
+#endif
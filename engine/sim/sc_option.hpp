@@ -44,6 +44,9 @@ public:
   { return _name; }
   std::ostream& print_option( std::ostream& stream ) const
   { return print( stream ); }
+  // Option parses names starting with its name (e.g., maps), instead of only its name
+  virtual bool prefix_match() const
+  { return false; }
 protected:
   virtual bool parse( sim_t*, const std::string& name, const std::string& value ) const = 0;
   virtual std::ostream& print( std::ostream& stream ) const = 0;
@@ -58,6 +61,28 @@ typedef std::unordered_map<std::string, std::string> map_t;
 typedef std::unordered_map<std::string, std::vector<std::string>> map_list_t;
 typedef std::function<bool(sim_t*,const std::string&, const std::string&)> function_t;
 typedef std::vector<std::string> list_t;
+
+// Name index of an option vector, for vectors parsing many options. Parsing an option tries only
+// the options of its name and the prefix options of its prefix, in the order of the vector, so the
+// first option accepting it is the same as without the index. The index is built on first use, and
+// rebuilt when the size of the vector changes.
+class index_t
+{
+  typedef std::unordered_map<std::string, std::vector<size_t>> position_map_t;
+
+  position_map_t m_names;
+  position_map_t m_prefixes;
+  size_t         m_size;
+
+  void build( const std::vector<std::unique_ptr<option_t>>& options );
+
+public:
+  index_t() : m_size( 0 )
+  { }
+
+  bool parse( sim_t*, const std::vector<std::unique_ptr<option_t>>&, const std::string& name, const std::string& value );
+};
+
 bool parse( sim_t*, const std::vector<std::unique_ptr<option_t>>&, const std::string& name, const std::string& value );
 void parse( sim_t*, const std::string& context, const std::vector<std::unique_ptr<option_t>>&, const std::string& options_str );
 void parse( sim_t*, const std::string& context, const std::vector<std::unique_ptr<option_t>>&, const std::vector<std::string>& strings );
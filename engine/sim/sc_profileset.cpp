@@ -7,6 +7,8 @@
 
 #include "simulationcraft.hpp"
 #include "sc_profileset.hpp"
+#include "util/git_info.hpp"
+#include "util/rapidjson/writer.h"
 
 namespace profileset
 {
@@ -69,14 +71,23 @@ std::string format_time( double seconds, bool milliseconds = true )
   return s.str();
 }
 
-// Deallocating profile_sim is the responsibility of the caller (i.e., profileset driver or
-// worker_t)
-void simulate_profileset( sim_t* parent, profile_set_t& set, sim_t*& profile_sim )
+// Profileset sim settings, applied before the profileset sim is initialized
+void configure_profileset_sim( const sim_t* parent, const profile_set_t& set, sim_t* profile_sim )
 {
-  // Reset random seed for the profileset sims
-  profile_sim -> seed = 0;
+  // Reset random seed for the profileset sims, unless they are paired up with the baseline
+  if ( ! parent -> paired_sampling )
+  {
+    profile_sim -> seed = 0;
+  }
   profile_sim -> profileset_enabled = true;
   profile_sim -> report_details = 0;
+  // Profilesets without their own reports only need the iterations of the profileset metrics,
+  // skip the resource timelines and the iterations of other metrics
+  if ( parent -> profileset_lean_collection && ! set.has_output() )
+  {
+    profile_sim -> lean_collection = true;
+    profile_sim -> buff_uptime_timeline = 0;
+  }
   if ( parent -> profileset_work_threads > 0 )
   {
     profile_sim -> threads = parent -> profileset_work_threads;
@@ -84,7 +95,19 @@ void simulate_profileset( sim_t* parent, profile_set_t& set, sim_t*& profile_sim
     // progress. For normal profileset simming we can rely on the normal progressbar updates
     profile_sim -> report_progress = false;
   }
-  else
+}
+
+// Deallocating profile_sim is the responsibility of the caller (i.e., profileset driver or
+// worker_t)
+void simulate_profileset( sim_t* parent, profile_set_t& set, sim_t*& profile_sim )
+{
+  // Sims prepared by the init threads are configured before their initialization
+  if ( ! profile_sim -> initialized )
+  {
+    configure_profileset_sim( parent, set, profile_sim );
+  }
+
+  if ( parent -> profileset_work_threads == 0 )
   {
     profile_sim -> progress_bar.set_base( "Profileset" );
     profile_sim -> progress_bar.set_phase( set.name() );
@@ -107,10 +130,14 @@ void simulate_profileset( sim_t* parent, profile_set_t& set, sim_t*& profile_sim
   }
 
   const auto player = profile_sim -> player_no_pet_list.data().front();
+  const auto parent_player = parent -> player_no_pet_list.data().front();
   auto progress = profile_sim -> progress( nullptr, 0 );
 
   range::for_each( parent -> profileset_metric, [ & ]( scale_metric_e metric ) {
     auto data = metric_data( player, metric );
+    auto paired_error = parent -> paired_sampling
+                        ? player -> scaling_paired_std_dev( *parent_player, metric ) * parent -> confidence_estimator
+                        : 0.0;
 
     set.result( metric )
       .min( data.min )
@@ -120,18 +147,22 @@ void simulate_profileset( sim_t* parent, profile_set_t& set, sim_t*& profile_sim
       .third_quartile( data.third_quartile )
       .max( data.max )
       .stddev( data.std_dev )
+      .paired_error( paired_error )
       .iterations( progress.current_iterations );
   } );
 
   if ( ! parent -> profileset_output_data.empty() )
   {
-    const auto parent_player = parent -> player_no_pet_list.data().front();
     range::for_each( parent -> profileset_output_data, [ & ]( const std::string& option ) {
         save_output_data( set, parent_player, player, option );
     } );
   }
 
-  set.cleanup_options();
+  // Racing rounds need the options for the next round
+  if ( set.race_iterations() == 0 )
+  {
+    set.cleanup_options();
+  }
 }
 
 void insert_data( highchart::bar_chart_t&   chart,
@@ -179,6 +210,68 @@ void insert_data( highchart::bar_chart_t&   chart,
   chart.add( "series.1.data", boxplot_entry );
 }
 
+// JSON output of the results of a single profileset
+void output_result( const sim_t& sim, profile_set_t& profileset, js::JsonOutput& obj )
+{
+  const auto& result = profileset.result();
+
+  obj[ "name" ] = profileset.name();
+  obj[ "mean" ] = result.mean();
+  obj[ "min" ] = result.min();
+  obj[ "max" ] = result.max();
+  obj[ "stddev" ] = result.stddev();
+
+  if ( result.paired_error() != 0 )
+  {
+    obj[ "paired_error" ] = result.paired_error();
+  }
+
+  if ( result.median() != 0 )
+  {
+    obj[ "median" ] = result.median();
+    obj[ "first_quartile" ] = result.first_quartile();
+    obj[ "third_quartile" ] = result.third_quartile();
+  }
+
+  obj[ "iterations" ] = as<uint64_t>( result.iterations() );
+
+  if ( profileset.is_eliminated() )
+  {
+    obj[ "race_round" ] = as<uint64_t>( profileset.eliminated_round() );
+  }
+
+  if ( profileset.results() > 1 )
+  {
+    auto results2 = obj[ "additional_metrics" ].make_array();
+    for ( size_t midx = 1; midx < sim.profileset_metric.size(); ++midx )
+    {
+      auto obj2 = results2.add();
+      const auto& result = profileset.result( sim.profileset_metric[ midx ] );
+
+      obj2[ "metric" ] = util::scale_metric_type_string( sim.profileset_metric[ midx ] );
+      obj2[ "mean" ] = result.mean();
+      obj2[ "min" ] = result.min();
+      obj2[ "max" ] = result.max();
+      obj2[ "stddev" ] = result.stddev();
+
+      if ( result.median() != 0 )
+      {
+        obj2[ "median" ] = result.median();
+        obj2[ "first_quartile" ] = result.first_quartile();
+        obj2[ "third_quartile" ] = result.third_quartile();
+      }
+    }
+  }
+
+  // Optional override ouput data
+  if ( ! sim.profileset_output_data.empty() ) {
+    const auto& output_data = profileset.output_data();
+    // TODO: Create the overrides object only if there is at least one override registered
+    auto ovr = obj[ "overrides" ];
+    fetch_output_data( output_data, ovr);
+  }
+}
+
 // Figure out if the option is the beginning of a player-scope option
 bool in_player_scope( const option_tuple_t& opt )
 {
@@ -193,6 +286,12 @@ bool in_player_scope( const option_tuple_t& opt )
   } ) != player_scope_opts.end();
 }
 
+// Number of profilesets simulated in the current (racing) round
+size_t profilesets_t::n_round_profilesets() const
+{
+  return m_race_round == 0 ? m_profilesets.size() : m_race_sets.size();
+}
+
 size_t profilesets_t::done_profilesets() const
 {
   if ( m_work_index <= n_workers() )
@@ -203,77 +302,75 @@ size_t profilesets_t::done_profilesets() const
   return m_work_index - n_workers();
 }
 
-sim_control_t* profilesets_t::create_sim_options( const sim_control_t*            original,
-                                                  const std::vector<std::string>& opts )
+// Parse the options of a profileset. Only the profileset's own options are parsed, the base
+// options are shared by all profilesets.
+bool profilesets_t::parse_options( const std::vector<std::string>& opts,
+                                   std::vector<option_tuple_t>&    options ) const
 {
-  if ( original == nullptr )
-  {
-    return nullptr;
-  }
-
-  sim_control_t new_options;
+  option_db_t new_options;
 
   try
   {
-    new_options.options.parse_args( opts );
+    new_options.parse_args( opts );
   }
   catch ( const std::exception& e ) {
     std::cerr << "ERROR! Incorrect option format: " << e.what() << std::endl;
-    return nullptr;
+    return false;
   }
 
-  // Find the insertion index only once, and cache the position to speed up init. 0 denotes "no
-  // enemy found".
-  if ( m_insert_index == -1 )
-  {
-    // Find a suitable player-scope variable to start looking for an "enemy" option. "spec" option
-    // must be always defined, so we can start the search below from it.
-    auto it = range::find_if( original -> options, []( const option_tuple_t& opt ) {
-      return in_player_scope( opt );
-    } );
+  options.assign( new_options.begin(), new_options.end() );
 
-    if ( it == original -> options.end() )
-    {
-      std::cerr << "ERROR! No start of player-scope defined for the simulation" << std::endl;
-      return nullptr;
-    }
+  return true;
+}
 
-    // Then, find the first enemy= line from the original options. The profileset options need to be
-    // inserted after the original player definition, but before any enemy options are defined.
-    auto enemy_it = std::find_if( it, original -> options.end(), []( const option_tuple_t& opt ) {
-      return util::str_compare_ci( opt.name, "enemy" );
-    } );
+// Set up the base options of the profilesets, the simulation options without any profileset.
+// options, and find the position where profileset options are inserted
+bool profilesets_t::init_original( const sim_t* sim )
+{
+  m_original = std::unique_ptr<sim_control_t>( new sim_control_t() );
 
-    if ( enemy_it == original -> options.end() )
-    {
-      m_insert_index = 0;
-    }
-    else
-    {
-      m_insert_index = std::distance( original -> options.begin(), enemy_it );
-    }
-  }
+  // Copy non-profileset. options to use as a base option setup for each profileset
+  range::copy_if( sim -> control -> options, std::back_inserter( m_original -> options ),
+    []( const option_tuple_t& opt ) {
+    return ! util::str_in_str_ci( opt.name, "profileset." );
+  } );
 
-  auto options_copy = new sim_control_t( *original );
+  // Find a suitable player-scope variable to start looking for an "enemy" option. "spec" option
+  // must be always defined, so we can start the search below from it.
+  auto it = range::find_if( m_original -> options, []( const option_tuple_t& opt ) {
+    return in_player_scope( opt );
+  } );
 
-  // No enemy option defined, insert profileset to the end of the original options
-  if ( m_insert_index == 0 )
+  if ( it == m_original -> options.end() )
   {
-    options_copy -> options.insert( options_copy -> options.end(),
-                                    new_options.options.begin(), new_options.options.end() );
+    std::cerr << "ERROR! No start of player-scope defined for the simulation" << std::endl;
+    return false;
   }
-  // Enemy option found, insert profileset options just before the enemy option
-  else
+
+  // Then, find the first enemy= line from the original options. The profileset options need to be
+  // inserted after the original player definition, but before any enemy options are defined. With
+  // no enemy options, profileset options are inserted to the end of the original options.
+  auto enemy_it = std::find_if( it, m_original -> options.end(), []( const option_tuple_t& opt ) {
+    return util::str_compare_ci( opt.name, "enemy" );
+  } );
+
+  m_insert_index = std::distance( m_original -> options.begin(), enemy_it );
+
+  if ( is_reusable( sim ) )
   {
-    options_copy -> options.insert( options_copy -> options.begin() + m_insert_index,
-                                    new_options.options.begin(), new_options.options.end() );
+    m_original_key = checkpoint::options_key( m_original.get() );
   }
 
-  return options_copy;
+  return true;
 }
 
-profile_set_t::profile_set_t( const std::string& name, sim_control_t* opts, bool has_output ) :
-  m_name( name ), m_options( opts ), m_has_output( has_output ), m_output_data( nullptr )
+profile_set_t::profile_set_t( const std::string& name, const sim_control_t* base_options,
+                              size_t insert_index, std::vector<option_tuple_t> options,
+                              bool has_output ) :
+  m_name( name ), m_base_options( base_options ), m_set_options( std::move( options ) ),
+  m_insert_index( insert_index ), m_options( nullptr ), m_has_output( has_output ),
+  m_output_data( nullptr ), m_race_iterations( 0 ), m_eliminated_round( 0 ), m_sim( nullptr ),
+  m_cache_key( 0 ), m_cached( false )
 {
 }
 
@@ -282,6 +379,48 @@ sim_control_t* profile_set_t::options() const
   return m_options;
 }
 
+// Build the simulator options of the profileset from the base options and the profileset options.
+// Racing rounds run the profileset with a fixed iteration budget, appended to the end of the
+// options so that it overrides any iterations or target_error given by the user.
+//
+// Note, the full copy cannot be avoided. The profileset options are inserted in the middle of the
+// base options, and sim_t::setup parses all of them in order, as player-scope options apply to the
+// most recently defined actor. The simulator also keeps the options for its thread children.
+sim_control_t* profile_set_t::sim_options()
+{
+  delete m_options;
+
+  m_options = new sim_control_t( *m_base_options );
+  m_options -> options.insert( m_options -> options.begin() + m_insert_index,
+                               m_set_options.begin(), m_set_options.end() );
+
+  if ( m_race_iterations > 0 )
+  {
+    m_options -> options.add( "global", "iterations", util::to_string( m_race_iterations ) );
+    m_options -> options.add( "global", "target_error", "0" );
+  }
+
+  return m_options;
+}
+
+void profile_set_t::eliminate( size_t round )
+{
+  m_eliminated_round = round;
+
+  cleanup_options();
+}
+
+void profile_set_t::release( bool output_data )
+{
+  cleanup_options();
+  std::vector<option_tuple_t>().swap( m_set_options );
+
+  if ( output_data )
+  {
+    m_output_data.reset();
+  }
+}
+
 void profile_set_t::cleanup_options()
 {
   delete m_options;
@@ -290,6 +429,7 @@ void profile_set_t::cleanup_options()
 
 profile_set_t::~profile_set_t()
 {
+  delete m_sim;
   delete m_options;
 }
 
@@ -337,9 +477,9 @@ profile_result_t& profile_set_t::result( scale_metric_e metric )
   return m_results.back();
 }
 
-worker_t::worker_t( profilesets_t* master, sim_t* p, profile_set_t* ps ) :
-  m_done( false ), m_parent( p ), m_master( master ), m_sim( nullptr ), m_profileset( ps ),
-  m_thread( nullptr )
+worker_t::worker_t( profilesets_t* master, sim_t* p, profile_set_t* ps, sim_t* prepared ) :
+  m_done( false ), m_prepared( prepared != nullptr ), m_parent( p ), m_master( master ),
+  m_sim( prepared ), m_profileset( ps ), m_thread( nullptr )
 {
   m_thread = new std::thread( std::bind( &worker_t::execute, this ) );
 }
@@ -367,7 +507,10 @@ sim_t* worker_t::sim() const
 
 void worker_t::execute()
 {
-  m_sim = new sim_t( m_parent, 0, m_profileset -> options() );
+  if ( ! m_sim )
+  {
+    m_sim = new sim_t( m_parent, 0, m_profileset -> sim_options() );
+  }
 
   simulate_profileset( m_parent, *m_profileset, m_sim );
 
@@ -402,6 +545,10 @@ void profilesets_t::cleanup_work()
       // Pure iterative time
       m_total_elapsed += sim -> elapsed_time;
 
+      record_init( sim, ( *it ) -> is_prepared() );
+      checkpoint_result( sim -> parent, *( *it ) -> profileset() );
+      stream_result( sim -> parent, *( *it ) -> profileset() );
+
       it = m_current_work.erase( it );
     }
     else
@@ -440,19 +587,44 @@ void profilesets_t::finalize_work()
   }
 }
 
-void profilesets_t::generate_work( sim_t* parent, std::unique_ptr<profile_set_t>& ptr_set )
+void profilesets_t::generate_work( sim_t* parent, profile_set_t* set )
 {
+  // Results served from the result cache
+  if ( set -> is_cached() )
+  {
+    stream_result( parent, *set );
+    return;
+  }
+
+  // The first simulated profileset without reports of its own measures the worker memory
+  if ( ! m_memory_measured && ! set -> has_output() )
+  {
+    measure_worker( parent, set );
+    return;
+  }
+
+  auto prepared_sim = take_prepared_sim( set );
+
   if ( m_mode == SEQUENTIAL )
   {
-    auto original_opts = parent -> control;
+    sim_t* profile_sim = prepared_sim;
 
-    parent -> control = ptr_set -> options();
+    if ( ! profile_sim )
+    {
+      auto original_opts = parent -> control;
 
-    sim_t* profile_sim = new sim_t( parent );
+      parent -> control = set -> sim_options();
 
-    parent -> control = original_opts;
+      profile_sim = new sim_t( parent );
 
-    simulate_profileset( parent, *ptr_set.get(), profile_sim );
+      parent -> control = original_opts;
+    }
+
+    simulate_profileset( parent, *set, profile_sim );
+
+    record_init( profile_sim, prepared_sim != nullptr );
+    checkpoint_result( parent, *set );
+    stream_result( parent, *set );
 
     delete profile_sim;
   }
@@ -473,13 +645,153 @@ void profilesets_t::generate_work( sim_t* parent, std::unique_ptr<profile_set_t>
       // Output profileset progressbar whenever we finish anything
       output_progressbar( parent );
 
-      m_current_work.push_back( std::unique_ptr<worker_t>( new worker_t { this, parent, ptr_set.get() } ) );
+      m_current_work.push_back( std::unique_ptr<worker_t>( new worker_t { this, parent, set, prepared_sim } ) );
+    }
+    else
+    {
+      delete prepared_sim;
     }
 
     m_work_lock.unlock();
   }
 }
 
+// Simulate the profileset on a freshly constructed sim, with nothing else in the process allocating
+// memory: running workers are finished first, and the init threads are paused. The growth of the
+// resident memory until the sim merges its thread sims is the memory of one profileset worker.
+// Memory the process has freed but still holds is reused first, so it is a lower bound.
+void profilesets_t::measure_worker( sim_t* parent, profile_set_t* set )
+{
+  m_memory_measured = true;
+
+  finalize_work();
+
+  std::unique_lock<std::mutex> lock( m_mutex );
+  m_measuring = true;
+  m_prepare.wait( lock, [ this, parent ]() {
+    return m_initializing == 0 || m_state == DONE || parent -> canceled;
+  } );
+
+  // Canceled, the prepared sims are released by the cancel
+  if ( m_state == DONE || parent -> canceled )
+  {
+    m_measuring = false;
+    return;
+  }
+  lock.unlock();
+
+  // The prepared sim is part of the base memory, the profileset is simulated on the fresh sim
+  auto prepared_sim = take_prepared_sim( set );
+  auto base_memory = computer_process::memory_usage();
+
+  auto profile_sim = new sim_t( parent, 0, set -> sim_options() );
+  profile_sim -> measure_memory = true;
+
+  simulate_profileset( parent, *set, profile_sim );
+
+  if ( profile_sim -> merge_memory > base_memory )
+  {
+    m_worker_memory = profile_sim -> merge_memory - base_memory;
+  }
+
+  lock.lock();
+  m_measuring = false;
+  m_prepare.notify_all();
+  lock.unlock();
+
+  record_init( profile_sim, false );
+  checkpoint_result( parent, *set );
+  stream_result( parent, *set );
+
+  delete profile_sim;
+  delete prepared_sim;
+}
+
+// Take the simulator prepared by the init threads for the profileset, and make room for the
+// next one
+sim_t* profilesets_t::take_prepared_sim( profile_set_t* set )
+{
+  m_mutex.lock();
+
+  auto sim = set -> release_sim();
+  if ( sim )
+  {
+    --m_prepared;
+    m_prepare.notify_one();
+  }
+
+  m_mutex.unlock();
+
+  return sim;
+}
+
+// Delete prepared simulators of profilesets that will not be simulated. They are relatives of the
+// parent sim, so they must be gone before the parent is destructed.
+void profilesets_t::release_prepared_sims()
+{
+  std::vector<sim_t*> sims;
+
+  m_mutex.lock();
+
+  range::for_each( m_profilesets, [ &sims ]( profileset_entry_t& set ) {
+    if ( auto sim = set -> release_sim() )
+    {
+      sims.push_back( sim );
+    }
+  } );
+
+  m_prepared -= sims.size();
+
+  m_mutex.unlock();
+
+  range::dispose( sims );
+}
+
+// Append the results of a finished profileset to the profileset stream, as a single line JSON
+// object with the fields of the profileset results in the JSON report. Profilesets in a racing round
+// have not finished yet.
+void profilesets_t::stream_result( const sim_t* sim, profile_set_t& set )
+{
+  if ( ! m_stream || ( set.race_iterations() > 0 && ! set.is_eliminated() ) ||
+       set.result().mean() == 0 )
+  {
+    return;
+  }
+
+  rapidjson::Document doc;
+  rapidjson::Value& v = doc;
+  v.SetObject();
+
+  js::JsonOutput root( doc, v );
+  output_result( *sim, set, root );
+
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer( buffer );
+  doc.Accept( writer );
+
+  std::fputs( buffer.GetString(), m_stream );
+  std::fputc( '\n', m_stream );
+  std::fflush( m_stream );
+
+  // The streamed record is the only consumer of the options and the output data of a finished
+  // profileset, unless the JSON report is written at the end
+  set.release( sim -> json_file_str.empty() && sim -> json2_file_str.empty() );
+}
+
+void profilesets_t::record_init( const sim_t* sim, bool prepared )
+{
+  if ( prepared )
+  {
+    m_prepared_sims++;
+    m_prepared_init_time += sim -> init_time;
+  }
+  else
+  {
+    m_fresh_sims++;
+    m_fresh_init_time += sim -> init_time;
+  }
+}
+
 bool profilesets_t::validate( sim_t* ps_sim )
 {
   if ( ps_sim -> player_no_pet_list.size() > 1 )
@@ -503,11 +815,20 @@ bool profilesets_t::parse( sim_t* sim )
       return false;
     }
 
-    m_mutex.lock();
+    std::unique_lock<std::mutex> lock( m_mutex );
 
-    if ( m_init_index == sim -> profileset_map.cend() )
+    // Bound the number of profileset sims initialized ahead of the simulation
+    m_prepare.wait( lock, [ this, sim ]() {
+      return ( m_prepared < m_max_prepared && ! m_measuring ) || m_state == DONE || sim -> canceled;
+    } );
+
+    if ( sim -> canceled )
+    {
+      continue;
+    }
+
+    if ( m_state == DONE || m_init_index == sim -> profileset_map.cend() )
     {
-      m_mutex.unlock();
       break;
     }
 
@@ -515,11 +836,13 @@ bool profilesets_t::parse( sim_t* sim )
     const auto& profileset_opts = m_init_index -> second;
 
     ++m_init_index;
+    ++m_prepared;
+    ++m_initializing;
 
-    m_mutex.unlock();
+    lock.unlock();
 
-    auto control = create_sim_options( m_original.get(), profileset_opts );
-    if ( control == nullptr )
+    std::vector<option_tuple_t> options;
+    if ( ! parse_options( profileset_opts, options ) )
     {
       set_state( DONE );
       return false;
@@ -540,39 +863,120 @@ bool profilesets_t::parse( sim_t* sim )
              util::str_compare_ci( name, "json2" );
     } ) != profileset_opts.end();
 
-    // Test that profileset options are OK, up to the simulation initialization
+    std::unique_ptr<profile_set_t> set( new profile_set_t( profileset_name, m_original.get(),
+      m_insert_index, std::move( options ), has_output_opts ) );
+
+    // Racing starts all profilesets with the iteration budget of the initial round
+    if ( is_racing( sim ) )
+    {
+      set -> race_iterations( sim -> profileset_race_iterations );
+    }
+
+    // Test that profileset options are OK. Option parsing errors are reported for every
+    // profileset, including the ones served from the result cache or the checkpoint.
+    sim_t* profile_sim = nullptr;
     try
     {
-      auto test_sim = new sim_t();
-      test_sim -> profileset_enabled = true;
+      profile_sim = new sim_t( sim, 0, set -> sim_options() );
+    }
+    catch ( const std::exception& e )
+    {
+      delete profile_sim;
+      std::cerr <<  "ERROR! Profileset '" << profileset_name << "' Setup failure: "
+                << e.what() << std::endl;
+      set_state( DONE );
+      return false;
+    }
+
+    // Serve the profileset from the result cache, or the checkpoint of an interrupted run,
+    // skipping initialization and simulation. Profilesets producing their own reports are always
+    // simulated.
+    auto cache_hit = false;
+    if ( ! has_output_opts && is_reusable( sim ) )
+    {
+      set -> cache_key( cache_key( *set ) );
+      cache_hit = is_caching( sim ) && cache_lookup( sim, *set );
+      set -> cached( cache_hit || checkpoint_lookup( sim, *set ) );
+    }
 
-      test_sim -> setup( control );
-      auto ret = test_sim -> init();
-      if ( ! ret || ! validate( test_sim ) )
+    if ( set -> is_cached() )
+    {
+      delete profile_sim;
+      profile_sim = nullptr;
+    }
+    // Test the profileset up to the simulation initialization. The initialized sim is kept, and
+    // simulated as is when the profileset's turn comes.
+    else
+    {
+      try
       {
-        delete test_sim;
+        configure_profileset_sim( sim, *set, profile_sim );
+
+        auto ret = profile_sim -> init();
+        if ( ! ret || ! validate( profile_sim ) )
+        {
+          delete profile_sim;
+          set_state( DONE );
+          return false;
+        }
+      }
+      catch ( const std::exception& e )
+      {
+        delete profile_sim;
+        std::cerr <<  "ERROR! Profileset '" << profileset_name << "' Setup failure: "
+                  << e.what() << std::endl;
         set_state( DONE );
         return false;
       }
+    }
 
-      delete test_sim;
+    lock.lock();
+
+    // Wake up the worker memory measurement waiting for the sims being initialized
+    --m_initializing;
+    if ( m_measuring )
+    {
+      m_prepare.notify_all();
     }
-    catch ( const std::exception& e )
+
+    // Canceled while initializing, the prepared sims have been released already
+    if ( m_state == DONE )
     {
-      std::cerr <<  "ERROR! Profileset '" << profileset_name << "' Setup failure: "
-                << e.what() << std::endl;
-      set_state( DONE );
-      return false;
+      --m_prepared;
+      lock.unlock();
+
+      delete profile_sim;
+      break;
+    }
+
+    if ( set -> is_cached() )
+    {
+      set -> cleanup_options();
+      --m_prepared;
+      if ( cache_hit )
+      {
+        m_cache_hits++;
+      }
+    }
+    else
+    {
+      set -> prepared_sim( profile_sim );
+      if ( is_caching( sim ) && set -> cache_key() != 0 )
+      {
+        m_cache_misses++;
+      }
     }
 
-    m_mutex.lock();
-    m_profilesets.push_back( std::unique_ptr<profile_set_t>(
-        new profile_set_t( profileset_name, control, has_output_opts ) ) );
+    m_profilesets.push_back( std::move( set ) );
     m_control.notify_one();
-    m_mutex.unlock();
   }
 
-  set_state( RUNNING );
+  m_mutex.lock();
+  if ( m_state != DONE )
+  {
+    m_state = RUNNING;
+  }
+  m_mutex.unlock();
 
   return true;
 }
@@ -622,16 +1026,25 @@ void profilesets_t::initialize( sim_t* sim )
     m_mode = PARALLEL;
   }
 
-  m_profilesets.reserve( sim -> profileset_map.size() + 1 );
+  // Keep a couple of initialized profileset sims ready for each worker, but enough for all init
+  // threads to stay busy
+  m_max_prepared = std::max( 2 * std::max( m_max_workers, size_t( 1 ) ),
+                             as<size_t>( sim -> profileset_init_threads ) );
 
-  // Generate a copy of the original control, and remove any and all profileset. options from it
-  m_original = std::unique_ptr<sim_control_t>( new sim_control_t() );
+  if ( is_caching( sim ) )
+  {
+    cache_load( sim );
+  }
 
-  // Copy non-profileset. options to use as a base option setup for each profileset
-  range::copy_if( sim -> control -> options, std::back_inserter( m_original -> options ),
-    []( const option_tuple_t& opt ) {
-    return ! util::str_in_str_ci( opt.name, "profileset." );
-  } );
+  m_profilesets.reserve( sim -> profileset_map.size() + 1 );
+
+  // Generate a copy of the original control, and remove any and all profileset. options from it.
+  // Profilesets only hold their own options on top of it.
+  if ( ! init_original( sim ) )
+  {
+    set_state( DONE );
+    return;
+  }
 
   // Spawn initialization threads, and start parsing through the profilesets
   set_state( INITIALIZING );
@@ -651,7 +1064,13 @@ void profilesets_t::initialize( sim_t* sim )
 
 void profilesets_t::cancel()
 {
-  if ( ! is_done() )
+  auto done = is_done();
+
+  // Wake up init threads waiting for room for prepared sims
+  set_state( DONE );
+  m_prepare.notify_all();
+
+  if ( ! done )
   {
     range::for_each( m_thread, []( std::thread& thread ) {
       if ( thread.joinable() )
@@ -661,7 +1080,7 @@ void profilesets_t::cancel()
     } );
   }
 
-  set_state( DONE );
+  release_prepared_sims();
 }
 
 void profilesets_t::set_state( state new_state )
@@ -682,7 +1101,9 @@ std::string profilesets_t::current_profileset_name()
     return std::string();
   }
 
-  std::string profileset_name = m_profilesets[ m_work_index - 1 ] -> name();
+  const profile_set_t* set = m_race_round == 0 ? m_profilesets[ m_work_index - 1 ].get()
+                                                : m_race_sets[ m_work_index - 1 ];
+  std::string profileset_name = set -> name();
   m_control_lock.unlock();
 
   return profileset_name;
@@ -697,6 +1118,19 @@ bool profilesets_t::iterate( sim_t* parent )
 
   auto original_opts = parent -> control;
 
+  if ( util::str_compare_ci( parent -> profileset_stream_file, "stdout" ) )
+  {
+    m_stream = io::cfile( stdout, io::cfile::no_close() );
+  }
+  else if ( ! parent -> profileset_stream_file.empty() )
+  {
+    m_stream = io::cfile( parent -> profileset_stream_file, "w" );
+    if ( ! m_stream )
+    {
+      parent -> errorf( "Unable to open profileset stream '%s'", parent -> profileset_stream_file.c_str() );
+    }
+  }
+
   m_start_time = util::wall_time();
 
   while ( ! is_done() )
@@ -719,7 +1153,7 @@ bool profilesets_t::iterate( sim_t* parent )
       }
     }
 
-    auto& set = m_profilesets[ m_work_index++ ];
+    auto set = m_profilesets[ m_work_index++ ].get();
 
     m_control_lock.unlock();
 
@@ -730,16 +1164,404 @@ bool profilesets_t::iterate( sim_t* parent )
   // not need to finalize any work (all work has been done by the loop above)
   finalize_work();
 
+  if ( is_racing( parent ) )
+  {
+    race( parent );
+  }
+
   // Output profileset progressbar whenever we finish anything
   output_progressbar( parent );
 
   parent -> control = original_opts;
 
+  if ( is_caching( parent ) && ! parent -> canceled )
+  {
+    cache_save( parent );
+  }
+
+  m_stream.close();
+
   set_state( DONE );
 
   return true;
 }
 
+// Racing is only worthwhile if the initial round is cheaper than a full profileset run
+bool profilesets_t::is_racing( const sim_t* parent ) const
+{
+  return parent -> profileset_race_top > 0 &&
+         parent -> profileset_race_iterations < parent -> iterations;
+}
+
+// Successive halving style racing. The initial round has simulated every profileset with
+// profileset_race_iterations iterations. Each round eliminates the profilesets that are, with the
+// given confidence, outside the top profileset_race_top, and simulates the remaining ones with a
+// larger iteration budget. Once few enough profilesets remain, or the next budget would reach the
+// cost of a full run, the remaining profilesets are simulated with their full options.
+void profilesets_t::race( sim_t* parent )
+{
+  range::for_each( m_profilesets, [ this ]( const profileset_entry_t& set ) {
+    m_race_sets.push_back( set.get() );
+  } );
+
+  auto budget = as<double>( parent -> profileset_race_iterations );
+  auto final_round = false;
+
+  while ( ! final_round && ! is_done() )
+  {
+    range::for_each( m_race_sets, [ this ]( const profile_set_t* set ) {
+      m_race_iterations += set -> result().iterations();
+    } );
+
+    race_eliminate( parent );
+
+    budget *= parent -> profileset_race_growth;
+    final_round = m_race_sets.size() <= as<size_t>( parent -> profileset_race_top ) ||
+                  budget >= race_full_iterations( parent );
+
+    range::for_each( m_race_sets, [ budget, final_round ]( profile_set_t* set ) {
+      set -> race_iterations( final_round ? 0 : static_cast<int>( budget ) );
+    } );
+
+    m_control_lock.lock();
+    m_race_round++;
+    m_work_index = 0;
+    m_control_lock.unlock();
+
+    while ( ! is_done() )
+    {
+      m_control_lock.lock();
+      if ( m_work_index == m_race_sets.size() )
+      {
+        m_control_lock.unlock();
+        break;
+      }
+
+      auto set = m_race_sets[ m_work_index++ ];
+
+      m_control_lock.unlock();
+
+      generate_work( parent, set );
+    }
+
+    finalize_work();
+  }
+
+  // The final round gives the cost of a full run, used to estimate the iterations racing saved
+  double final_iterations = 0;
+  range::for_each( m_race_sets, [ this, &final_iterations ]( const profile_set_t* set ) {
+    m_race_iterations += set -> result().iterations();
+    final_iterations += set -> result().iterations();
+  } );
+
+  if ( m_race_sets.size() > 0 )
+  {
+    m_race_full_iterations = final_iterations / m_race_sets.size();
+  }
+}
+
+// Eliminate profilesets whose confidence interval of the mean lies entirely below the lower bound
+// of the profileset ranked profileset_race_top. Profilesets that failed to simulate are eliminated
+// as well.
+void profilesets_t::race_eliminate( const sim_t* parent )
+{
+  auto top = as<size_t>( parent -> profileset_race_top );
+  auto z = rng::stdnormal_inv( 1.0 - ( 1.0 - parent -> profileset_race_confidence ) / 2.0 );
+
+  auto error = [ z ]( const profile_result_t& result ) {
+    return z * result.stddev() / std::sqrt( as<double>( result.iterations() ) );
+  };
+
+  std::vector<double> lower_bounds;
+  range::for_each( m_race_sets, [ &lower_bounds, &error ]( const profile_set_t* set ) {
+    const auto& result = set -> result();
+    if ( result.iterations() > 0 )
+    {
+      lower_bounds.push_back( result.mean() - error( result ) );
+    }
+  } );
+
+  auto threshold = -std::numeric_limits<double>::max();
+  if ( lower_bounds.size() > top )
+  {
+    std::nth_element( lower_bounds.begin(), lower_bounds.begin() + top - 1, lower_bounds.end(),
+                      std::greater<double>() );
+    threshold = lower_bounds[ top - 1 ];
+  }
+
+  auto round = m_race_round + 1;
+  auto it = std::remove_if( m_race_sets.begin(), m_race_sets.end(),
+    [ this, parent, threshold, round, &error ]( profile_set_t* set ) {
+    const auto& result = set -> result();
+    if ( result.iterations() == 0 || result.mean() + error( result ) < threshold )
+    {
+      set -> eliminate( round );
+      stream_result( parent, *set );
+      return true;
+    }
+
+    return false;
+  } );
+
+  m_race_sets.erase( it, m_race_sets.end() );
+}
+
+// Iterations a full profileset run takes. With target_error, estimate the iterations from the
+// standard deviation of the profilesets still in the race.
+double profilesets_t::race_full_iterations( const sim_t* parent ) const
+{
+  if ( parent -> target_error <= 0 )
+  {
+    return parent -> iterations;
+  }
+
+  double iterations = 0;
+  range::for_each( m_race_sets, [ parent, &iterations ]( const profile_set_t* set ) {
+    const auto& result = set -> result();
+    if ( result.mean() > 0 )
+    {
+      auto n = parent -> confidence_estimator * result.stddev() * 100.0 /
+               ( parent -> target_error * result.mean() );
+      iterations = std::max( iterations, n * n );
+    }
+  } );
+
+  return std::min( iterations, as<double>( parent -> iterations ) );
+}
+
+// Estimated iterations saved by racing, compared to running every profileset fully
+double profilesets_t::race_iterations_saved() const
+{
+  return std::max( 0.0, m_profilesets.size() * m_race_full_iterations - m_race_iterations );
+}
+
+// Profileset results can be reused (result cache, checkpoints) when the statistics are all the
+// profileset output there is
+bool profilesets_t::is_reusable( const sim_t* sim ) const
+{
+  return ! is_racing( sim ) && sim -> profileset_output_data.empty();
+}
+
+bool profilesets_t::is_caching( const sim_t* sim ) const
+{
+  return ! sim -> profileset_cache_file.empty() && is_reusable( sim );
+}
+
+// Cache key of the effective profileset options, the profileset options hashed on top of the
+// base options
+uint64_t profilesets_t::cache_key( const profile_set_t& set ) const
+{
+  auto key = checkpoint::options_key( set.set_options(), m_original_key );
+
+  // 0 denotes a profileset that is not cached
+  return key != 0 ? key : 1;
+}
+
+// Fill in the profileset results from the cache, if results for all profileset metrics exist
+bool profilesets_t::cache_lookup( const sim_t* sim, profile_set_t& set ) const
+{
+  auto it = m_cache.find( set.cache_key() );
+  if ( it == m_cache.end() )
+  {
+    return false;
+  }
+
+  const auto& results = it -> second;
+
+  auto missing = range::find_if( sim -> profileset_metric, [ &results ]( scale_metric_e metric ) {
+    return range::find_if( results, [ metric ]( const profile_result_t& result ) {
+      return result.metric() == metric;
+    } ) == results.end();
+  } );
+
+  if ( missing != sim -> profileset_metric.end() )
+  {
+    return false;
+  }
+
+  range::for_each( sim -> profileset_metric, [ &results, &set ]( scale_metric_e metric ) {
+    set.result( metric ) = *range::find_if( results, [ metric ]( const profile_result_t& result ) {
+      return result.metric() == metric;
+    } );
+  } );
+
+  return true;
+}
+
+static std::string checkpoint_key( const profile_set_t& set )
+{
+  std::stringstream s;
+  s << std::hex << set.cache_key();
+  return s.str();
+}
+
+// Fill in the profileset results from the checkpoint of an interrupted earlier run. The results of
+// each metric are stored as ( metric, iterations, mean, median, min, max, first quartile, third
+// quartile, stddev, paired error ).
+bool profilesets_t::checkpoint_lookup( sim_t* sim, profile_set_t& set ) const
+{
+  auto values = sim -> checkpoint.find( "profileset", checkpoint_key( set ) );
+  if ( values.size() != sim -> profileset_metric.size() * 10 )
+  {
+    return false;
+  }
+
+  for ( size_t i = 0; i < sim -> profileset_metric.size(); ++i )
+  {
+    if ( static_cast<scale_metric_e>( values[ i * 10 ] ) != sim -> profileset_metric[ i ] )
+    {
+      return false;
+    }
+  }
+
+  for ( size_t i = 0; i < sim -> profileset_metric.size(); ++i )
+  {
+    auto v = values.begin() + i * 10;
+
+    set.result( sim -> profileset_metric[ i ] )
+      .iterations( static_cast<size_t>( v[ 1 ] ) )
+      .mean( v[ 2 ] )
+      .median( v[ 3 ] )
+      .min( v[ 4 ] )
+      .max( v[ 5 ] )
+      .first_quartile( v[ 6 ] )
+      .third_quartile( v[ 7 ] )
+      .stddev( v[ 8 ] )
+      .paired_error( v[ 9 ] );
+  }
+
+  return true;
+}
+
+void profilesets_t::checkpoint_result( sim_t* sim, const profile_set_t& set ) const
+{
+  if ( set.cache_key() == 0 || set.result().iterations() == 0 || sim -> is_canceled() )
+  {
+    return;
+  }
+
+  std::vector<double> values;
+  range::for_each( sim -> profileset_metric, [ &set, &values ]( scale_metric_e metric ) {
+    const auto& result = set.result( metric );
+    values.insert( values.end(), {
+      static_cast<double>( metric ), as<double>( result.iterations() ), result.mean(), result.median(),
+      result.min(), result.max(), result.first_quartile(), result.third_quartile(),
+      result.stddev(), result.paired_error()
+    } );
+  } );
+
+  sim -> checkpoint.add( "profileset", checkpoint_key( set ), values );
+}
+
+static std::string cache_header()
+{
+  std::string header = SC_VERSION;
+  if ( git_info::available() )
+  {
+    header += " ";
+    header += git_info::revision();
+  }
+
+  return header;
+}
+
+// Load the result cache. The cache is discarded as a whole if it was written by a different
+// simulator version.
+void profilesets_t::cache_load( sim_t* sim )
+{
+  io::ifstream file;
+  file.open( sim -> profileset_cache_file );
+  if ( ! file.is_open() )
+  {
+    return;
+  }
+
+  std::string line;
+  if ( ! std::getline( file, line ) || line != cache_header() )
+  {
+    return;
+  }
+
+  while ( std::getline( file, line ) )
+  {
+    std::istringstream s( line );
+
+    uint64_t key;
+    std::string metric_str;
+    size_t iterations;
+    double mean, median, min, max, first_quartile, third_quartile, stddev, paired_error;
+
+    s >> std::hex >> key >> std::dec >> metric_str >> iterations >> mean >> median >> min >> max
+      >> first_quartile >> third_quartile >> stddev >> paired_error;
+
+    auto metric = util::parse_scale_metric( metric_str );
+    if ( ! s || metric == SCALE_METRIC_NONE )
+    {
+      sim -> errorf( "Invalid profileset cache entry in '%s', ignoring: %s",
+        sim -> profileset_cache_file.c_str(), line.c_str() );
+      continue;
+    }
+
+    m_cache[ key ].push_back( profile_result_t( metric )
+      .iterations( iterations )
+      .mean( mean )
+      .median( median )
+      .min( min )
+      .max( max )
+      .first_quartile( first_quartile )
+      .third_quartile( third_quartile )
+      .stddev( stddev )
+      .paired_error( paired_error ) );
+  }
+}
+
+// Save the result cache, the loaded entries and results of the profilesets simulated in this run
+void profilesets_t::cache_save( sim_t* sim ) const
+{
+  auto cache = m_cache;
+
+  range::for_each( m_profilesets, [ sim, &cache ]( const profileset_entry_t& set ) {
+    if ( set -> cache_key() == 0 || set -> is_cached() || set -> result().iterations() == 0 )
+    {
+      return;
+    }
+
+    auto& results = cache[ set -> cache_key() ];
+    results.clear();
+    range::for_each( sim -> profileset_metric, [ &set, &results ]( scale_metric_e metric ) {
+      results.push_back( set -> result( metric ) );
+    } );
+  } );
+
+  io::ofstream file;
+  file.open( sim -> profileset_cache_file );
+  if ( ! file.is_open() )
+  {
+    sim -> errorf( "Unable to save profileset cache to '%s'", sim -> profileset_cache_file.c_str() );
+    return;
+  }
+
+  file << cache_header() << '\n';
+  file.precision( std::numeric_limits<double>::max_digits10 );
+
+  range::for_each( cache, [ &file ]( const std::pair<const uint64_t, std::vector<profile_result_t>>& entry ) {
+    range::for_each( entry.second, [ &file, &entry ]( const profile_result_t& result ) {
+      file << std::hex << entry.first << std::dec
+           << ' ' << util::scale_metric_type_abbrev( result.metric() )
+           << ' ' << result.iterations()
+           << ' ' << result.mean()
+           << ' ' << result.median()
+           << ' ' << result.min()
+           << ' ' << result.max()
+           << ' ' << result.first_quartile()
+           << ' ' << result.third_quartile()
+           << ' ' << result.stddev()
+           << ' ' << result.paired_error()
+           << '\n';
+    } );
+  } );
+}
+
 void profilesets_t::notify_worker()
 {
   m_work.notify_one();
@@ -770,10 +1592,15 @@ void profilesets_t::output_progressbar( const sim_t* parent ) const
 
   s << "Profilesets (" << m_max_workers << "*" << parent -> profileset_work_threads << "): ";
 
+  if ( m_race_round > 0 )
+  {
+    s << "round " << m_race_round + 1 << " ";
+  }
+
   auto done = done_profilesets();
-  auto pct = done / as<double>( m_profilesets.size() );
+  auto pct = done / as<double>( n_round_profilesets() );
 
-  s << done << "/" << m_profilesets.size() << " ";
+  s << done << "/" << n_round_profilesets() << " ";
 
   std::string status = "[";
   status.insert( 1, parent -> progress_bar.steps, '.' );
@@ -794,7 +1621,7 @@ void profilesets_t::output_progressbar( const sim_t* parent ) const
 
   auto average_per_sim = m_total_elapsed / as<double>( done );
   auto elapsed = util::wall_time() - m_start_time;
-  auto work_left = m_profilesets.size() - done;
+  auto work_left = n_round_profilesets() - done;
   auto time_left = ( work_left / m_max_workers ) * average_per_sim;
 
   // Average time per done simulation
@@ -812,71 +1639,61 @@ void profilesets_t::output_progressbar( const sim_t* parent ) const
 
   s << '\r';
 
-  std::cout << s.str();
-  fflush( stdout );
+  parent -> progress_bar.out() << s.str() << std::flush;
 }
 
 void profilesets_t::output( const sim_t& sim, js::JsonOutput& root ) const
 {
   root[ "metric" ] = util::scale_metric_type_string( sim.profileset_metric.front() );
 
-  auto results = root[ "results" ].make_array();
+  if ( m_race_iterations > 0 )
+  {
+    auto race = root[ "race" ];
 
-  range::for_each( m_profilesets, [ &results, &sim ]( const profileset_entry_t& profileset ) {
-    const auto& result = profileset -> result();
+    race[ "top" ] = sim.profileset_race_top;
+    race[ "rounds" ] = as<uint64_t>( m_race_round + 1 );
+    race[ "eliminated" ] = as<uint64_t>( m_profilesets.size() - m_race_sets.size() );
+    race[ "iterations" ] = m_race_iterations;
+    race[ "iterations_saved" ] = util::round( race_iterations_saved() );
+  }
 
-    if ( result.mean() == 0 )
-    {
-      return;
-    }
+  if ( is_caching( &sim ) )
+  {
+    auto cache = root[ "cache" ];
 
-    auto&& obj = results.add();
+    cache[ "hits" ] = as<uint64_t>( m_cache_hits );
+    cache[ "misses" ] = as<uint64_t>( m_cache_misses );
+  }
 
-    obj[ "name" ] = profileset -> name();
-    obj[ "mean" ] = result.mean();
-    obj[ "min" ] = result.min();
-    obj[ "max" ] = result.max();
-    obj[ "stddev" ] = result.stddev();
+  if ( m_prepared_sims + m_fresh_sims > 0 )
+  {
+    auto init = root[ "init" ];
 
-    if ( result.median() != 0 )
-    {
-      obj[ "median" ] = result.median();
-      obj[ "first_quartile" ] = result.first_quartile();
-      obj[ "third_quartile" ] = result.third_quartile();
-    }
+    init[ "prepared_sims" ] = as<uint64_t>( m_prepared_sims );
+    init[ "prepared_init_time" ] = m_prepared_init_time;
+    init[ "fresh_sims" ] = as<uint64_t>( m_fresh_sims );
+    init[ "fresh_init_time" ] = m_fresh_init_time;
+  }
 
-    obj[ "iterations" ] = as<uint64_t>( result.iterations() );
+  if ( m_worker_memory > 0 )
+  {
+    auto memory = root[ "memory" ];
 
-    if ( profileset -> results() > 1 )
-    {
-      auto results2 = obj[ "additional_metrics" ].make_array();
-      for ( size_t midx = 1; midx < sim.profileset_metric.size(); ++midx )
-      {
-        auto obj2 = results2.add();
-        const auto& result = profileset -> result( sim.profileset_metric[ midx ] );
+    memory[ "per_worker" ] = as<uint64_t>( m_worker_memory );
+    memory[ "workers" ] = as<uint64_t>( std::max( m_max_workers, size_t( 1 ) ) );
+  }
 
-        obj2[ "metric" ] = util::scale_metric_type_string( sim.profileset_metric[ midx ] );
-        obj2[ "mean" ] = result.mean();
-        obj2[ "min" ] = result.min();
-        obj2[ "max" ] = result.max();
-        obj2[ "stddev" ] = result.stddev();
+  auto results = root[ "results" ].make_array();
 
-        if ( result.median() != 0 )
-        {
-          obj2[ "median" ] = result.median();
-          obj2[ "first_quartile" ] = result.first_quartile();
-          obj2[ "third_quartile" ] = result.third_quartile();
-        }
-      }
+  range::for_each( m_profilesets, [ &results, &sim ]( const profileset_entry_t& profileset ) {
+    if ( profileset -> result().mean() == 0 )
+    {
+      return;
     }
 
-    // Optional override ouput data
-    if ( ! sim.profileset_output_data.empty() ) {
-      const auto& output_data = profileset -> output_data();
-      // TODO: Create the overrides object only if there is at least one override registered
-      auto ovr = obj[ "overrides" ];
-      fetch_output_data( output_data, ovr);
-    }
+    auto&& obj = results.add();
+
+    output_result( sim, *profileset, obj );
   } );
 }
 
@@ -894,9 +1711,49 @@ void profilesets_t::output( const sim_t& sim, FILE* out ) const
   generate_sorted_profilesets( results );
 
   range::for_each( results, [ out ]( const profile_set_t* profileset ) {
-    util::fprintf( out, "    %-10.3f : %s\n",
-      profileset -> result().median(), profileset -> name().c_str() );
+    if ( profileset -> is_eliminated() )
+    {
+      util::fprintf( out, "    %-10.3f : %s (eliminated in round %u)\n",
+        profileset -> result().median(), profileset -> name().c_str(),
+        as<unsigned>( profileset -> eliminated_round() ) );
+    }
+    else
+    {
+      util::fprintf( out, "    %-10.3f : %s\n",
+        profileset -> result().median(), profileset -> name().c_str() );
+    }
   } );
+
+  if ( m_race_iterations > 0 )
+  {
+    util::fprintf( out, "\nProfileset racing (top %d): %u/%u eliminated in %u rounds, "
+                        "%.0f iterations simulated, ~%.0f iterations saved\n",
+      sim.profileset_race_top,
+      as<unsigned>( m_profilesets.size() - m_race_sets.size() ),
+      as<unsigned>( m_profilesets.size() ),
+      as<unsigned>( m_race_round + 1 ),
+      as<double>( m_race_iterations ), race_iterations_saved() );
+  }
+
+  if ( is_caching( &sim ) )
+  {
+    util::fprintf( out, "\nProfileset cache: %u hits, %u misses\n",
+      as<unsigned>( m_cache_hits ), as<unsigned>( m_cache_misses ) );
+  }
+
+  if ( m_prepared_sims + m_fresh_sims > 0 )
+  {
+    util::fprintf( out, "\nProfileset init: %u sims initialized ahead (%.3fs), %u sims initialized "
+                        "fresh (%.3fs)\n",
+      as<unsigned>( m_prepared_sims ), m_prepared_init_time,
+      as<unsigned>( m_fresh_sims ), m_fresh_init_time );
+  }
+
+  if ( m_worker_memory > 0 )
+  {
+    util::fprintf( out, "\nProfileset memory: %.1f MiB per worker, %u workers\n",
+      m_worker_memory / ( 1024.0 * 1024.0 ), as<unsigned>( std::max( m_max_workers, size_t( 1 ) ) ) );
+  }
 }
 
 void profilesets_t::output( const sim_t& sim, io::ofstream& out ) const
@@ -1079,6 +1936,13 @@ void create_options( sim_t* sim )
 
   sim -> add_option( opt_int( "profileset_work_threads", sim -> profileset_work_threads ) );
   sim -> add_option( opt_int( "profileset_init_threads", sim -> profileset_init_threads ) );
+  sim -> add_option( opt_int( "profileset_race_top", sim -> profileset_race_top, 0, std::numeric_limits<int>::max() ) );
+  sim -> add_option( opt_int( "profileset_race_iterations", sim -> profileset_race_iterations, 2, std::numeric_limits<int>::max() ) );
+  sim -> add_option( opt_float( "profileset_race_growth", sim -> profileset_race_growth, 1.1, 100.0 ) );
+  sim -> add_option( opt_float( "profileset_race_confidence", sim -> profileset_race_confidence, 0.5, 0.9999 ) );
+  sim -> add_option( opt_string( "profileset_cache_file", sim -> profileset_cache_file ) );
+  sim -> add_option( opt_string( "profileset_stream", sim -> profileset_stream_file ) );
+  sim -> add_option( opt_bool( "profileset_lean_collection", sim -> profileset_lean_collection ) );
 }
 
 statistical_data_t collect( const extended_sample_data_t& c )
@@ -10,6 +10,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <unordered_map>
 
 #include "sc_option.hpp"
 #include "util/generic.hpp"
@@ -45,15 +46,18 @@ class profile_result_t
   double         m_1stquartile;
   double         m_3rdquartile;
   double         m_stddev;
+  double         m_paired_error;
   size_t         m_iterations;
 
 public:
   profile_result_t() : m_metric( SCALE_METRIC_NONE ), m_mean( 0 ), m_median( 0 ), m_min( 0 ),
-    m_max( 0 ), m_1stquartile( 0 ), m_3rdquartile( 0 ), m_stddev( 0 ), m_iterations( 0 )
+    m_max( 0 ), m_1stquartile( 0 ), m_3rdquartile( 0 ), m_stddev( 0 ), m_paired_error( 0 ),
+    m_iterations( 0 )
   { }
 
   profile_result_t( scale_metric_e m ) : m_metric( m ), m_mean( 0 ), m_median( 0 ), m_min( 0 ),
-    m_max( 0 ), m_1stquartile( 0 ), m_3rdquartile( 0 ), m_stddev( 0 ), m_iterations( 0 )
+    m_max( 0 ), m_1stquartile( 0 ), m_3rdquartile( 0 ), m_stddev( 0 ), m_paired_error( 0 ),
+    m_iterations( 0 )
   { }
 
   scale_metric_e metric() const
@@ -101,6 +105,13 @@ public:
   profile_result_t& stddev( double v )
   { m_stddev = v; return *this; }
 
+  // Error of the mean difference to the baseline, with paired_sampling
+  double paired_error() const
+  { return m_paired_error; }
+
+  profile_result_t& paired_error( double v )
+  { m_paired_error = v; return *this; }
+
   size_t iterations() const
   { return m_iterations; }
 
@@ -359,23 +370,88 @@ public:
 class profile_set_t
 {
   std::string                            m_name;
+
+  // Base options shared by all profilesets, the options of the profileset itself, and the position
+  // in the base options where they are inserted
+  const sim_control_t*                   m_base_options;
+  std::vector<option_tuple_t>            m_set_options;
+  size_t                                 m_insert_index;
+
+  // Full simulator options of the current run, built from the above when a simulator is created
   sim_control_t*                         m_options;
   bool                                   m_has_output;
   std::vector<profile_result_t>          m_results;
   std::unique_ptr<profile_output_data_t> m_output_data;
 
+  // Racing mode, iteration budget of the next run (0 = full run), and the (1-based) racing round
+  // where the set was eliminated
+  int                                    m_race_iterations;
+  size_t                                 m_eliminated_round;
+
+  // Simulator initialized when the profileset options were validated, simulated as is instead of
+  // constructing and initializing a new one
+  sim_t*                                 m_sim;
+
+  // Result cache key of the profileset options (0 = not cacheable), and whether the results were
+  // served from the cache
+  uint64_t                               m_cache_key;
+  bool                                   m_cached;
+
 public:
-  profile_set_t( const std::string& name, sim_control_t* opts, bool has_output );
+  profile_set_t( const std::string& name, const sim_control_t* base_options, size_t insert_index,
+                 std::vector<option_tuple_t> options, bool has_output );
 
   ~profile_set_t();
 
   void cleanup_options();
 
+  // Release the options, and optionally the output data, of a finished profileset
+  void release( bool output_data );
+
   const std::string& name() const
   { return m_name; }
 
   sim_control_t* options() const;
 
+  const std::vector<option_tuple_t>& set_options() const
+  { return m_set_options; }
+
+  // Options for the next run of the profileset, including the racing iteration budget
+  sim_control_t* sim_options();
+
+  int race_iterations() const
+  { return m_race_iterations; }
+
+  void race_iterations( int iterations )
+  { m_race_iterations = iterations; }
+
+  bool is_eliminated() const
+  { return m_eliminated_round > 0; }
+
+  size_t eliminated_round() const
+  { return m_eliminated_round; }
+
+  void eliminate( size_t round );
+
+  void prepared_sim( sim_t* sim )
+  { m_sim = sim; }
+
+  // Transfer the ownership of the prepared simulator (if any) to the caller
+  sim_t* release_sim()
+  { auto sim = m_sim; m_sim = nullptr; return sim; }
+
+  uint64_t cache_key() const
+  { return m_cache_key; }
+
+  void cache_key( uint64_t key )
+  { m_cache_key = key; }
+
+  bool is_cached() const
+  { return m_cached; }
+
+  void cached( bool v )
+  { m_cached = v; }
+
   bool has_output() const
   { return m_has_output; }
 
@@ -400,6 +476,7 @@ public:
 class worker_t
 {
   bool           m_done;
+  bool           m_prepared;
   sim_t*         m_parent;
   profilesets_t* m_master;
 
@@ -408,7 +485,7 @@ class worker_t
   std::thread*   m_thread;
 
 public:
-  worker_t( profilesets_t*, sim_t*, profile_set_t* );
+  worker_t( profilesets_t*, sim_t*, profile_set_t*, sim_t* prepared );
   ~worker_t();
 
   const std::thread& thread() const;
@@ -418,6 +495,12 @@ public:
   bool is_done() const
   { return m_done == true; }
 
+  bool is_prepared() const
+  { return m_prepared; }
+
+  profile_set_t* profileset() const
+  { return m_profileset; }
+
   sim_t* sim() const;
 };
 
@@ -445,8 +528,12 @@ class profilesets_t
   state                                  m_state;
   simulation_mode                        m_mode;
   profileset_vector_t                    m_profilesets;
+  // Base options of all profilesets (the simulation options without profileset. options), the
+  // position where profileset options are inserted into them, and their result cache key. Immutable
+  // once the profileset init threads start.
   std::unique_ptr<sim_control_t>         m_original;
-  int64_t                                m_insert_index;
+  size_t                                 m_insert_index;
+  uint64_t                               m_original_key;
   size_t                                 m_work_index;
   std::mutex                             m_mutex;
   std::unique_lock<std::mutex>           m_control_lock;
@@ -469,6 +556,39 @@ class profilesets_t
   double                                 m_start_time;
   double                                 m_total_elapsed;
 
+  // Racing mode, current round (0 = initial round over all profilesets), the profilesets still in
+  // the race, and iteration bookkeeping
+  size_t                                 m_race_round;
+  std::vector<profile_set_t*>            m_race_sets;
+  uint64_t                               m_race_iterations;
+  double                                 m_race_full_iterations;
+
+  // Profileset sims initialized by the init threads ahead of the simulation, bounded by
+  // m_max_prepared, and init time bookkeeping of prepared and freshly initialized sims
+  size_t                                 m_max_prepared;
+  size_t                                 m_prepared;
+  std::condition_variable                m_prepare;
+  size_t                                 m_prepared_sims;
+  size_t                                 m_fresh_sims;
+  double                                 m_prepared_init_time;
+  double                                 m_fresh_init_time;
+
+  // Result cache (profileset_cache_file), results of earlier runs keyed by the profileset cache
+  // key
+  std::unordered_map<uint64_t, std::vector<profile_result_t>> m_cache;
+  size_t                                 m_cache_hits;
+  size_t                                 m_cache_misses;
+
+  // Newline-delimited JSON stream of finished profilesets (profileset_stream)
+  io::cfile                              m_stream;
+
+  // Resident memory of a single profileset worker, measured on the first simulated profileset
+  // while the init threads are paused (m_measuring) and no profileset sims are initializing
+  bool                                   m_measuring;
+  bool                                   m_memory_measured;
+  size_t                                 m_initializing;
+  size_t                                 m_worker_memory;
+
   bool validate( sim_t* sim );
 
   int max_name_length() const;
@@ -481,17 +601,43 @@ class profilesets_t
   void set_state( state new_state );
 
   size_t n_workers() const;
-  void generate_work( sim_t*, std::unique_ptr<profile_set_t>& );
+  size_t n_round_profilesets() const;
+  void generate_work( sim_t*, profile_set_t* );
+  void measure_worker( sim_t*, profile_set_t* );
+  sim_t* take_prepared_sim( profile_set_t* );
+  void release_prepared_sims();
+  void record_init( const sim_t*, bool prepared );
+  void stream_result( const sim_t*, profile_set_t& );
   void cleanup_work();
   void finalize_work();
 
-  sim_control_t* create_sim_options( const sim_control_t*, const std::vector<std::string>& opts );
+  bool is_racing( const sim_t* ) const;
+  void race( sim_t* );
+  void race_eliminate( const sim_t* );
+  double race_full_iterations( const sim_t* ) const;
+  double race_iterations_saved() const;
+
+  bool is_reusable( const sim_t* ) const;
+  bool is_caching( const sim_t* ) const;
+  bool checkpoint_lookup( sim_t*, profile_set_t& ) const;
+  void checkpoint_result( sim_t*, const profile_set_t& ) const;
+  uint64_t cache_key( const profile_set_t& ) const;
+  bool cache_lookup( const sim_t*, profile_set_t& ) const;
+  void cache_load( sim_t* );
+  void cache_save( sim_t* ) const;
+
+  bool init_original( const sim_t* );
+  bool parse_options( const std::vector<std::string>& opts, std::vector<option_tuple_t>& options ) const;
 public:
   profilesets_t() : m_state( STARTED ), m_mode( SEQUENTIAL ),
-    m_original( nullptr ), m_insert_index( -1 ),
+    m_original( nullptr ), m_insert_index( 0 ), m_original_key( 0 ),
     m_work_index( 0 ), m_control_lock( m_mutex, std::defer_lock ),
     m_max_workers( 0 ), m_work_lock( m_work_mutex, std::defer_lock ),
-    m_start_time( 0 ), m_total_elapsed( 0 )
+    m_start_time( 0 ), m_total_elapsed( 0 ),
+    m_race_round( 0 ), m_race_iterations( 0 ), m_race_full_iterations( 0 ),
+    m_max_prepared( 0 ), m_prepared( 0 ), m_prepared_sims( 0 ), m_fresh_sims( 0 ),
+    m_prepared_init_time( 0 ), m_fresh_init_time( 0 ), m_cache_hits( 0 ), m_cache_misses( 0 ),
+    m_measuring( false ), m_memory_measured( false ), m_initializing( 0 ), m_worker_memory( 0 )
   { }
 
   ~profilesets_t()
@@ -68,7 +68,7 @@ void progress_bar_t::init()
   else
   {
     interval = sim.work_queue -> size();
-    if ( sim.deterministic || sim.strict_work_queue )
+    if ( sim.private_work_queues() )
     {
       interval *= sim.threads;
     }
@@ -344,8 +344,23 @@ void progress_bar_t::output( bool finished )
   s << status;
   s << terminator;
 
-  std::cout << s.str();
-  fflush( stdout );
+  out() << s.str() << std::flush;
+}
+
+std::ostream& progress_bar_t::out() const
+{
+  const sim_t* root = &sim;
+  while ( root -> parent )
+  {
+    root = root -> parent;
+  }
+
+  if ( util::str_compare_ci( root -> profileset_stream_file, "stdout" ) )
+  {
+    return std::cerr;
+  }
+
+  return std::cout;
 }
 
 void progress_bar_t::progress()
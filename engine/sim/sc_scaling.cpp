@@ -3,6 +3,10 @@
 // Send questions to natehieter@gmail.com
 // ==========================================================================
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
 #include "simulationcraft.hpp"
 
 namespace { // UNNAMED NAMESPACE ==========================================
@@ -70,6 +74,19 @@ bool parse_normalize_scale_factors( sim_t* sim,
   return true;
 }
 
+// paired_error =============================================================
+
+// Error of the difference between the delta and the reference player from the paired differences of
+// their iterations, or 0 if the sims were not paired up with paired_sampling.
+
+double paired_error( const sim_t* delta_sim, const player_t* delta_p, const player_t* ref_p, scale_metric_e sm )
+{
+  if ( ! delta_sim -> paired_sampling )
+    return 0;
+
+  return delta_p -> scaling_paired_std_dev( *ref_p, sm ) * delta_sim -> confidence_estimator;
+}
+
 struct compare_scale_factors
 {
   player_t* player;
@@ -114,6 +131,8 @@ scaling_t::scaling_t( sim_t* s ) :
   current_scaling_stat( STAT_NONE ),
   num_scaling_stats( 0 ),
   remaining_scaling_stats( 0 ),
+  scale_factor_work_threads( 0 ),
+  active_sims(),
   scale_over(), scaling_metric( SCALE_METRIC_DPS ), scale_over_player()
 {
   create_options();
@@ -136,15 +155,32 @@ double scaling_t::progress( std::string& phase, std::string* detailed )
     return baseline_sim -> progress(detailed ).pct();
   }
 
-  phase  = "Scaling - ";
-  phase += util::stat_type_abbrev( current_scaling_stat );
-
   int completed_scaling_stats = ( num_scaling_stats - remaining_scaling_stats );
 
   double stat_progress = completed_scaling_stats / static_cast<double>( num_scaling_stats );
 
   sim -> detailed_progress( detailed, completed_scaling_stats, num_scaling_stats );
 
+  // Concurrent stat sims each carry their share of the progress of their stat
+  if ( ! active_sims.empty() )
+  {
+    phase = "Scaling -";
+    for ( const auto s : active_sims )
+    {
+      stat_e stat = s -> scaling -> scale_stat;
+      int sims_per_stat = center_scale_delta && ! stat_may_cap( stat ) ? 2 : 1;
+
+      phase += ' ';
+      phase += util::stat_type_abbrev( stat );
+      stat_progress += s -> progress().pct() / ( num_scaling_stats * sims_per_stat );
+    }
+
+    return stat_progress;
+  }
+
+  phase  = "Scaling - ";
+  phase += util::stat_type_abbrev( current_scaling_stat );
+
   double divisor = num_scaling_stats * 2.0;
 
   if ( ref_sim  ) stat_progress += divisor * ref_sim  -> progress().pct();
@@ -213,126 +249,427 @@ void scaling_t::analyze_stats()
 
   if ( ! num_scaling_stats ) return; // No Stats to scale
 
+  // Skip stats completed by an interrupted earlier run
+  stats_to_scale.erase( std::remove_if( stats_to_scale.begin(), stats_to_scale.end(), [ this ]( stat_e stat ) {
+    return resume_stat( stat );
+  } ), stats_to_scale.end() );
+
+  mutex.lock();
+  remaining_scaling_stats = as<int>( stats_to_scale.size() );
+  mutex.unlock();
+
+  if ( stats_to_scale.empty() ) return;
+
   mutex.lock();
   baseline_sim = sim; // Take the current sim as baseline
   mutex.unlock();
 
-  for ( size_t k = 0; k < stats_to_scale.size(); ++k )
+  if ( scale_factor_work_threads > 0 && sim -> threads / scale_factor_work_threads > 1 )
+  {
+    analyze_stats_concurrently( stats_to_scale );
+  }
+  else
   {
-    if ( sim -> is_canceled() ) break;
+    for ( size_t k = 0; k < stats_to_scale.size(); ++k )
+    {
+      if ( sim -> is_canceled() ) break;
 
-    current_scaling_stat = stats_to_scale[ k ]; // Stat we're scaling over
-    const stat_e& stat = current_scaling_stat;
+      current_scaling_stat = stats_to_scale[ k ]; // Stat we're scaling over
+      const stat_e& stat = current_scaling_stat;
 
-    double scale_delta = stats.get_stat( stat );
-    assert ( scale_delta );
+      double scale_delta = stats.get_stat( stat );
+      assert ( scale_delta );
 
-    bool center = center_scale_delta && ! stat_may_cap( stat );
+      bool center = center_scale_delta && ! stat_may_cap( stat );
+
+      mutex.lock();
+      ref_sim = baseline_sim;
+      delta_sim = new sim_t( sim );
+      mutex.unlock();
+
+      delta_sim -> progress_bar.set_base( util::stat_type_abbrev( stat ) );
 
-    mutex.lock();
-    ref_sim = baseline_sim;
-    delta_sim = new sim_t( sim );
-    mutex.unlock();
+      delta_sim -> scaling -> scale_stat = stat;
+      delta_sim -> scaling -> scale_value = +scale_delta / ( center ? 2 : 1 );
+      delta_sim -> execute();
 
-    delta_sim -> progress_bar.set_base( util::stat_type_abbrev( stat ) );
+      if ( center )
+      {
+        mutex.lock();
+        ref_sim = new sim_t( sim );
+        mutex.unlock();
 
-    delta_sim -> scaling -> scale_stat = stat;
-    delta_sim -> scaling -> scale_value = +scale_delta / ( center ? 2 : 1 );
-    delta_sim -> execute();
+        ref_sim -> progress_bar.set_base( std::string( "Ref " ) + util::stat_type_abbrev( stat ) );
 
+        ref_sim -> scaling -> scale_stat = stat;
+        ref_sim -> scaling -> scale_value = center ? -( scale_delta / 2 ) : 0;
+        ref_sim -> execute();
+      }
+
+      analyze_stat_sims( stat, ref_sim, delta_sim );
+
+      mutex.lock();
+      if ( ref_sim != baseline_sim && ref_sim != sim )
+      {
+        delete ref_sim;
+        ref_sim = nullptr;
+      }
+      delete delta_sim;
+      delta_sim  = nullptr;
+      remaining_scaling_stats--;
+      mutex.unlock();
+    }
+  }
+
+  if ( baseline_sim != sim ) delete baseline_sim;
+  baseline_sim = nullptr;
+
+  sim -> checkpoint.save();
+}
+
+// scaling_t::analyze_stats_concurrently ====================================
+
+/* Run the delta (and centered reference) sims of all stats as a pool of
+ * sim->threads / scale_factor_work_threads concurrent sims, each using
+ * scale_factor_work_threads threads. Scale factors of a stat are computed on
+ * the calling thread as soon as all of its sims are done.
+ */
+
+void scaling_t::analyze_stats_concurrently( const std::vector<stat_e>& stats_to_scale )
+{
+  struct stat_work_t
+  {
+    stat_e stat;
+    sim_t* ref;
+    sim_t* delta;
+    int pending;
+  };
+
+  std::vector<stat_work_t> work;
+  std::vector<std::pair<size_t, bool>> jobs; // ( work index, reference sim )
+  for ( size_t k = 0; k < stats_to_scale.size(); ++k )
+  {
+    stat_e stat = stats_to_scale[ k ];
+    bool center = center_scale_delta && ! stat_may_cap( stat );
+
+    work.push_back( { stat, center ? nullptr : baseline_sim, nullptr, center ? 2 : 1 } );
+    jobs.push_back( std::make_pair( k, false ) );
     if ( center )
     {
+      jobs.push_back( std::make_pair( k, true ) );
+    }
+  }
+
+  std::mutex work_mutex;
+  std::condition_variable work_done;
+  std::vector<size_t> finished;
+  std::atomic<size_t> next_job( 0 );
+
+  current_scaling_stat = stats_to_scale.front();
+
+  auto worker = [ & ]() {
+    while ( ! sim -> is_canceled() )
+    {
+      size_t job = next_job++;
+      if ( job >= jobs.size() )
+      {
+        break;
+      }
+
+      auto& w = work[ jobs[ job ].first ];
+      bool is_ref = jobs[ job ].second;
+      double scale_delta = stats.get_stat( w.stat );
+      bool center = center_scale_delta && ! stat_may_cap( w.stat );
+
+      sim_t* job_sim = new sim_t( sim );
+      job_sim -> threads = scale_factor_work_threads;
+      job_sim -> report_progress = false;
+      job_sim -> scaling -> scale_stat = w.stat;
+      if ( is_ref )
+      {
+        job_sim -> scaling -> scale_value = -( scale_delta / 2 );
+      }
+      else
+      {
+        job_sim -> scaling -> scale_value = +scale_delta / ( center ? 2 : 1 );
+      }
+
       mutex.lock();
-      ref_sim = new sim_t( sim );
+      active_sims.push_back( job_sim );
       mutex.unlock();
 
-      ref_sim -> progress_bar.set_base( std::string( "Ref " ) + util::stat_type_abbrev( stat ) );
+      job_sim -> execute();
 
-      ref_sim -> scaling -> scale_stat = stat;
-      ref_sim -> scaling -> scale_value = center ? -( scale_delta / 2 ) : 0;
-      ref_sim -> execute();
+      std::lock_guard<std::mutex> lock( work_mutex );
+      ( is_ref ? w.ref : w.delta ) = job_sim;
+      if ( --w.pending == 0 )
+      {
+        finished.push_back( jobs[ job ].first );
+        work_done.notify_one();
+      }
     }
+  };
+
+  std::vector<std::thread> workers;
+  for ( int i = 0, end = std::min( sim -> threads / scale_factor_work_threads, as<int>( jobs.size() ) ); i < end; ++i )
+  {
+    workers.push_back( std::thread( worker ) );
+  }
+
+  size_t n_done = 0;
+  while ( n_done < work.size() && ! sim -> is_canceled() )
+  {
+    std::unique_lock<std::mutex> lock( work_mutex );
+    work_done.wait_for( lock, std::chrono::seconds( 1 ) );
+    std::vector<size_t> done;
+    done.swap( finished );
+    lock.unlock();
+
+    for ( auto idx : done )
+    {
+      auto& w = work[ idx ];
+      analyze_stat_sims( w.stat, w.ref, w.delta );
+
+      mutex.lock();
+      active_sims.erase( std::remove_if( active_sims.begin(), active_sims.end(), [ &w ]( sim_t* s ) {
+        return s == w.ref || s == w.delta;
+      } ), active_sims.end() );
+      if ( w.ref != baseline_sim && w.ref != sim )
+      {
+        delete w.ref;
+      }
+      delete w.delta;
+      w.ref = w.delta = nullptr;
+      remaining_scaling_stats--;
+      mutex.unlock();
+
+      ++n_done;
+    }
+
+    output_progressbar( as<int>( n_done ) );
+  }
 
-    for ( size_t j = 0; j < sim -> players_by_name.size(); j++ )
+  range::for_each( workers, []( std::thread& t ) { t.join(); } );
+
+  // Sims of stats left unfinished by a cancel
+  mutex.lock();
+  active_sims.clear();
+  for ( auto& w : work )
+  {
+    if ( w.ref != baseline_sim && w.ref != sim )
     {
-      player_t* p = sim -> players_by_name[ j ];
+      delete w.ref;
+    }
+    delete w.delta;
+  }
+  mutex.unlock();
 
-      if ( ! p -> scaling -> scales_with[ stat ] ) continue;
+  if ( sim -> report_progress )
+  {
+    util::fprintf( stdout, "\n" );
+  }
+}
 
-      player_t*   ref_p =   ref_sim -> find_player( p -> name() );
-      player_t* delta_p = delta_sim -> find_player( p -> name() );
-      assert( ref_p && "Reference Player not found" );
-      assert( delta_p && "Delta player not found" );
+// scaling_t::output_progressbar ============================================
 
-      double divisor = scale_delta;
+void scaling_t::output_progressbar( int done ) const
+{
+  if ( ! sim -> report_progress )
+  {
+    return;
+  }
 
-      if ( delta_p -> invert_scaling )
-        divisor = -divisor;
+  std::stringstream s;
 
-      if ( divisor < 0.0 ) divisor += ref_p -> scaling -> over_cap[ stat ];
+  s << "Scale factors (" << sim -> threads / scale_factor_work_threads << "*"
+    << scale_factor_work_threads << "): " << done << "/" << num_scaling_stats << " ";
 
-      for ( scale_metric_e sm = SCALE_METRIC_NONE; sm < SCALE_METRIC_MAX; sm++ )
-      {
+  std::string status = "[";
+  status.insert( 1, sim -> progress_bar.steps, '.' );
+  status += "]";
 
-        double delta_score = delta_p -> scaling_for_metric( sm ).value;
-        double   ref_score = ref_p -> scaling_for_metric( sm ).value;
+  int length = static_cast<int>( sim -> progress_bar.steps * done / static_cast<double>( num_scaling_stats ) + 0.5 );
+  for ( int i = 1; i < length + 1; ++i )
+  {
+    status[ i ] = '=';
+  }
 
-        double delta_error = delta_p -> scaling_for_metric( sm ).stddev * delta_sim -> confidence_estimator;
-        double   ref_error = ref_p -> scaling_for_metric( sm ).stddev * ref_sim -> confidence_estimator;
+  if ( length > 0 )
+  {
+    status[ length ] = '>';
+  }
 
-        // TODO: this is the only place in the entire code base where scaling_delta_dps shows up, 
-        // apart from declaration in simulationcraft.hpp line 4535. Possible to remove?
-        p -> scaling -> scaling_delta_dps[ sm ].set_stat( stat, delta_score );
+  s << status << '\r';
 
-        double score = ( delta_score - ref_score ) / divisor;
-        double error = delta_error * delta_error + ref_error * ref_error;
+  std::cout << s.str();
+  fflush( stdout );
+}
 
-        if ( error > 0 )
-          error = sqrt( error );
+// scaling_t::analyze_stat_sims =============================================
 
-        error = fabs( error / divisor );
+void scaling_t::analyze_stat_sims( stat_e stat, sim_t* ref, sim_t* delta )
+{
+  double scale_delta = stats.get_stat( stat );
 
-        if ( fabs( divisor ) < 1.0 ) // For things like Weapon Speed, show the gain per 0.1 speed gain rather than every 1.0.
-        {
-          score /= 10.0;
-          error /= 10.0;
-          delta_error /= 10.0;
-        }
+  bool center = center_scale_delta && ! stat_may_cap( stat );
 
-        analyze_ability_stats( stat, divisor, p, ref_p, delta_p );
+  for ( size_t j = 0; j < sim -> players_by_name.size(); j++ )
+  {
+    player_t* p = sim -> players_by_name[ j ];
 
-        if ( center )
-          p -> scaling -> scaling_compare_error[ sm ].set_stat( stat, error );
-        else
-          p -> scaling -> scaling_compare_error[ sm ].set_stat( stat, delta_error / divisor );
+    if ( ! p -> scaling -> scales_with[ stat ] ) continue;
 
-        p -> scaling -> scaling[ sm ].set_stat( stat, score );
-        p -> scaling -> scaling_error[ sm ].set_stat( stat, error );
+    player_t*   ref_p =   ref -> find_player( p -> name() );
+    player_t* delta_p = delta -> find_player( p -> name() );
+    assert( ref_p && "Reference Player not found" );
+    assert( delta_p && "Delta player not found" );
+
+    double divisor = scale_delta;
+
+    if ( delta_p -> invert_scaling )
+      divisor = -divisor;
+
+    if ( divisor < 0.0 ) divisor += ref_p -> scaling -> over_cap[ stat ];
+
+    for ( scale_metric_e sm = SCALE_METRIC_NONE; sm < SCALE_METRIC_MAX; sm++ )
+    {
+
+      double delta_score = delta_p -> scaling_for_metric( sm ).value;
+      double   ref_score = ref_p -> scaling_for_metric( sm ).value;
+
+      double delta_error = delta_p -> scaling_for_metric( sm ).stddev * delta -> confidence_estimator;
+      double   ref_error = ref_p -> scaling_for_metric( sm ).stddev * ref -> confidence_estimator;
+
+      // TODO: this is the only place in the entire code base where scaling_delta_dps shows up, 
+      // apart from declaration in simulationcraft.hpp line 4535. Possible to remove?
+      p -> scaling -> scaling_delta_dps[ sm ].set_stat( stat, delta_score );
+
+      double score = ( delta_score - ref_score ) / divisor;
+      double error = delta_error * delta_error + ref_error * ref_error;
+
+      if ( error > 0 )
+        error = sqrt( error );
+
+      // Paired iterations share most of their variance, which cancels out of the difference
+      double p_error = paired_error( delta, delta_p, ref_p, sm );
+      if ( p_error > 0 )
+        error = p_error;
+
+      error = fabs( error / divisor );
+
+      if ( fabs( divisor ) < 1.0 ) // For things like Weapon Speed, show the gain per 0.1 speed gain rather than every 1.0.
+      {
+        score /= 10.0;
+        error /= 10.0;
+        delta_error /= 10.0;
       }
+
+      analyze_ability_stats( stat, divisor, p, ref_p, delta_p );
+
+      if ( center )
+        p -> scaling -> scaling_compare_error[ sm ].set_stat( stat, error );
+      else
+        p -> scaling -> scaling_compare_error[ sm ].set_stat( stat, delta_error / divisor );
+
+      p -> scaling -> scaling[ sm ].set_stat( stat, score );
+      p -> scaling -> scaling_error[ sm ].set_stat( stat, error );
     }
+  }
 
-    if ( debug_scale_factors )
+  checkpoint_stat( stat );
+
+  if ( debug_scale_factors )
+  {
+    std::cout << "\nref_sim report for '" << util::stat_type_string( stat ) << "'..." << std::endl;
+    report::print_text( ref, true );
+    std::cout << "\ndelta_sim report for '" << util::stat_type_string( stat ) << "'..." << std::endl;
+    report::print_text( delta, true );
+  }
+}
+
+// scaling_t::checkpoint_stat ===============================================
+
+/* Checkpoint the scale factors of a stat, or lag (STAT_MAX), as the per
+ * player, per metric scaling values in player order.
+ */
+
+void scaling_t::checkpoint_stat( stat_e stat )
+{
+  if ( sim -> is_canceled() ) return;
+
+  std::vector<double> values;
+
+  for ( size_t j = 0; j < sim -> players_by_name.size(); j++ )
+  {
+    player_t* p = sim -> players_by_name[ j ];
+
+    if ( stat != STAT_MAX && ! p -> scaling -> scales_with[ stat ] ) continue;
+
+    for ( scale_metric_e sm = SCALE_METRIC_NONE; sm < SCALE_METRIC_MAX; sm++ )
     {
-      std::cout << "\nref_sim report for '" << util::stat_type_string( stat ) << "'..." << std::endl;
-      report::print_text( ref_sim, true );
-      std::cout << "\ndelta_sim report for '" << util::stat_type_string( stat ) << "'..." << std::endl;
-      report::print_text( delta_sim, true );
+      if ( stat == STAT_MAX )
+      {
+        values.push_back( p -> scaling -> scaling_lag[ sm ] );
+        values.push_back( p -> scaling -> scaling_lag_error[ sm ] );
+      }
+      else
+      {
+        values.push_back( p -> scaling -> scaling_delta_dps[ sm ].get_stat( stat ) );
+        values.push_back( p -> scaling -> scaling_compare_error[ sm ].get_stat( stat ) );
+        values.push_back( p -> scaling -> scaling[ sm ].get_stat( stat ) );
+        values.push_back( p -> scaling -> scaling_error[ sm ].get_stat( stat ) );
+      }
     }
+  }
+
+  sim -> checkpoint.add( "scaling", stat == STAT_MAX ? "lag" : util::stat_type_abbrev( stat ), values );
+}
 
-    mutex.lock();
-    if ( ref_sim != baseline_sim && ref_sim != sim )
+// scaling_t::resume_stat ===================================================
+
+/* Restore the scale factors of a stat, or lag (STAT_MAX), from the
+ * checkpoint of an interrupted earlier run.
+ */
+
+bool scaling_t::resume_stat( stat_e stat )
+{
+  auto values = sim -> checkpoint.find( "scaling", stat == STAT_MAX ? "lag" : util::stat_type_abbrev( stat ) );
+  if ( values.empty() ) return false;
+
+  size_t n_values = 0;
+  for ( size_t j = 0; j < sim -> players_by_name.size(); j++ )
+  {
+    if ( stat == STAT_MAX || sim -> players_by_name[ j ] -> scaling -> scales_with[ stat ] )
+      n_values += SCALE_METRIC_MAX * ( stat == STAT_MAX ? 2 : 4 );
+  }
+
+  if ( values.size() != n_values ) return false;
+
+  auto v = values.begin();
+  for ( size_t j = 0; j < sim -> players_by_name.size(); j++ )
+  {
+    player_t* p = sim -> players_by_name[ j ];
+
+    if ( stat != STAT_MAX && ! p -> scaling -> scales_with[ stat ] ) continue;
+
+    for ( scale_metric_e sm = SCALE_METRIC_NONE; sm < SCALE_METRIC_MAX; sm++ )
     {
-      delete ref_sim;
-      ref_sim = nullptr;
+      if ( stat == STAT_MAX )
+      {
+        p -> scaling -> scaling_lag[ sm ]       = *v++;
+        p -> scaling -> scaling_lag_error[ sm ] = *v++;
+      }
+      else
+      {
+        p -> scaling -> scaling_delta_dps[ sm ].set_stat( stat, *v++ );
+        p -> scaling -> scaling_compare_error[ sm ].set_stat( stat, *v++ );
+        p -> scaling -> scaling[ sm ].set_stat( stat, *v++ );
+        p -> scaling -> scaling_error[ sm ].set_stat( stat, *v++ );
+      }
     }
-    delete delta_sim;  
-    delta_sim  = nullptr;
-    remaining_scaling_stats--;
-    mutex.unlock();
   }
 
-  if ( baseline_sim != sim ) delete baseline_sim;
-  baseline_sim = nullptr;
+  return true;
 }
 
 /* Creates scale factors for stats_t objects
@@ -369,6 +706,8 @@ void scaling_t::analyze_lag()
 
   if ( sim -> players_by_name.empty() ) return;
 
+  if ( resume_stat( STAT_MAX ) ) return;
+
   if ( sim -> report_progress )
   {
     util::fprintf( stdout, "\nGenerating scale factors for lag...\n" );
@@ -411,6 +750,10 @@ void scaling_t::analyze_lag()
       double ref_error = ref_p -> scaling_for_metric( sm ).stddev * ref_sim -> confidence_estimator;
       double error = sqrt( delta_error * delta_error + ref_error * ref_error );
 
+      double p_error = paired_error( delta_sim, delta_p, ref_p, sm );
+      if ( p_error > 0 )
+        error = p_error;
+
       double score = ( delta_score - ref_score ) / divisor;
 
       error = fabs( error / divisor );
@@ -422,6 +765,9 @@ void scaling_t::analyze_lag()
   if ( ref_sim != sim ) delete ref_sim;
   delete delta_sim;
   delta_sim = ref_sim = nullptr;
+
+  checkpoint_stat( STAT_MAX );
+  sim -> checkpoint.save();
 }
 
 // scaling_t::normalize =====================================================
@@ -504,6 +850,7 @@ void scaling_t::create_options()
   sim->add_option(opt_bool("positive_scale_delta", positive_scale_delta));
   sim->add_option(opt_bool("scale_lag", scale_lag));
   sim->add_option(opt_float("scale_factor_noise", scale_factor_noise));
+  sim->add_option(opt_int("scale_factor_work_threads", scale_factor_work_threads));
   sim->add_option(opt_float("scale_strength", stats.attribute[ATTR_STRENGTH]));
   sim->add_option(opt_float("scale_agility", stats.attribute[ATTR_AGILITY]));
   sim->add_option(opt_float("scale_stamina", stats.attribute[ATTR_STAMINA]));
@@ -110,6 +110,61 @@ bool parse_ptr( sim_t*             sim,
   return true;
 }
 
+// parse_event_queue ========================================================
+
+bool parse_event_queue( sim_t*             sim,
+                        const std::string& name,
+                        const std::string& value )
+{
+  if ( name != "event_queue" ) return false;
+
+  if ( util::str_compare_ci( value, "wheel" ) )
+    sim -> event_mgr.queue_type = event_manager_t::QUEUE_WHEEL;
+  else if ( util::str_compare_ci( value, "hierarchical" ) )
+    sim -> event_mgr.queue_type = event_manager_t::QUEUE_HIERARCHICAL;
+  else
+    return false;
+
+  return true;
+}
+
+// parse_combat_length_sampling =============================================
+
+bool parse_combat_length_sampling( sim_t*             sim,
+                                   const std::string& name,
+                                   const std::string& value )
+{
+  if ( name != "combat_length_sampling" ) return false;
+
+  if ( util::str_compare_ci( value, "sweep" ) )
+    sim -> combat_length_sampling = sim_t::LENGTH_SAMPLING_SWEEP;
+  else if ( util::str_compare_ci( value, "random" ) )
+    sim -> combat_length_sampling = sim_t::LENGTH_SAMPLING_RANDOM;
+  else if ( util::str_compare_ci( value, "stratified" ) )
+    sim -> combat_length_sampling = sim_t::LENGTH_SAMPLING_STRATIFIED;
+  else
+    return false;
+
+  return true;
+}
+
+// radical_inverse ==========================================================
+
+// Base 2 radical inverse (van der Corput sequence) of n. The first 2^k values of the sequence
+// place exactly one value in each interval of width 2^-k of [0, 1).
+double radical_inverse( uint64_t n )
+{
+  n = ( n << 32 ) | ( n >> 32 );
+  n = ( ( n & 0x0000ffff0000ffffULL ) << 16 ) | ( ( n & 0xffff0000ffff0000ULL ) >> 16 );
+  n = ( ( n & 0x00ff00ff00ff00ffULL ) << 8 ) | ( ( n & 0xff00ff00ff00ff00ULL ) >> 8 );
+  n = ( ( n & 0x0f0f0f0f0f0f0f0fULL ) << 4 ) | ( ( n & 0xf0f0f0f0f0f0f0f0ULL ) >> 4 );
+  n = ( ( n & 0x3333333333333333ULL ) << 2 ) | ( ( n & 0xccccccccccccccccULL ) >> 2 );
+  n = ( ( n & 0x5555555555555555ULL ) << 1 ) | ( ( n & 0xaaaaaaaaaaaaaaaaULL ) >> 1 );
+
+  // Top 53 bits, exactly representable in a double
+  return ( n >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
 // parse_active =============================================================
 
 bool parse_active( sim_t*             sim,
@@ -1315,6 +1370,9 @@ struct compare_name
   }
 };
 
+// Chart capture of the calling thread, see sim_t::chart_capture_scope_t
+thread_local sim_t::chart_capture_t* active_chart_capture = nullptr;
+
 } // UNNAMED NAMESPACE ===================================================
 
 // ==========================================================================
@@ -1332,6 +1390,9 @@ sim_t::sim_t() :
   max_time( timespan_t::zero() ),
   expected_iteration_time( timespan_t::zero() ),
   vary_combat_length( 0.0 ),
+  combat_length_sampling( LENGTH_SAMPLING_SWEEP ),
+  combat_length_sample( 0.5 ),
+  stratified_target_error( false ),
   current_iteration( -1 ),
   iterations( 0 ),
   canceled( 0 ),
@@ -1368,7 +1429,7 @@ sim_t::sim_t() :
   travel_variance( 0 ), default_skill( 1.0 ), reaction_time( timespan_t::from_seconds( 0.5 ) ),
   regen_periodicity( timespan_t::from_seconds( 0.25 ) ),
   ignite_sampling_delta( timespan_t::from_seconds( 0.2 ) ),
-  fixed_time( false ), optimize_expressions( false ),
+  fixed_time( false ), optimize_expressions( false ), compile_expressions( false ),
   current_slot( -1 ),
   optimal_raid( 0 ), log( 0 ), debug_each( 0 ), save_profiles( 0 ), default_actions( 0 ),
   normalized_stat( STAT_NONE ),
@@ -1380,6 +1441,7 @@ sim_t::sim_t() :
   requires_regen_event( false ), single_actor_batch( false ),
   progressbar_type( 0 ),
   armory_retries( 3 ),
+  http_concurrency( 8 ),
   enemy_death_pct( 0 ), rel_target_level( -1 ), target_level( -1 ),
   target_adds( 0 ), desired_targets( 1 ), enable_taunts( false ),
   use_item_verification( true ),
@@ -1387,7 +1449,8 @@ sim_t::sim_t() :
   disable_set_bonuses( false ), disable_2_set( 1 ), disable_4_set( 1 ), enable_2_set( 1 ), enable_4_set( 1 ),
   pvp_crit( false ),
   active_enemies( 0 ), active_allies( 0 ),
-  _rng(), seed( 0 ), deterministic( 0 ), strict_work_queue( 0 ),
+  _rng(), iteration_rng_streams( false ), iteration_stream( 0 ), paired_sampling( 0 ),
+  antithetic_sampling( 0 ), seed( 0 ), deterministic( 0 ), strict_work_queue( 0 ),
   average_range( true ), average_gauss( false ),
   convergence_scale( 2 ),
   fight_style( "Patchwerk" ), add_waves( 0 ), overrides( overrides_t() ),
@@ -1399,7 +1462,11 @@ sim_t::sim_t() :
   reforge_plot( new reforge_plot_t( this ) ),
   elapsed_cpu( 0.0 ),
   elapsed_time( 0.0 ),
+  work_finish_time( 0 ),
   work_done( 0 ),
+  measure_memory( false ),
+  merge_memory( 0 ),
+  iterate_successful( false ),
   iteration_dmg( 0 ), priority_iteration_dmg( 0 ), iteration_heal( 0 ), iteration_absorb( 0 ),
   raid_dps(), total_dmg(), raid_hps(), total_heal(), total_absorb(), raid_aps(),
   simulation_length( "Simulation Length", false ),
@@ -1425,11 +1492,15 @@ sim_t::sim_t() :
   enable_dps_healing( false ),
   scaling_normalized( 1.0 ),
   // Multi-Threading
-  threads( 0 ), thread_index( 0 ), process_priority( computer_process::BELOW_NORMAL ),
+  threads( 0 ), report_threads( 1 ), thread_index( 0 ), process_priority( computer_process::BELOW_NORMAL ),
   work_queue( new work_queue_t() ),
+  work_chunk(),
+  work_queue_chunk_size( 1 ),
   spell_query(), spell_query_level( MAX_LEVEL ),
   pause_mutex( nullptr ),
   paused( false ),
+  cancel_requested( false ),
+  interrupt_requested( false ),
   chart_show_relative_difference( false ),
   chart_boxplot_percentile( .25 ),
   display_hotfixes( false ),
@@ -1439,7 +1510,19 @@ sim_t::sim_t() :
   profileset_output_data(),
   profileset_enabled( false ),
   profileset_work_threads( 0 ),
-  profileset_init_threads( 1 )
+  profileset_init_threads( 1 ),
+  profileset_race_top( 0 ),
+  profileset_race_iterations( 100 ),
+  profileset_race_growth( 2.0 ),
+  profileset_race_confidence( 0.95 ),
+  profileset_cache_file(),
+  profileset_stream_file(),
+  profileset_lean_collection( true ),
+  lean_collection( false ),
+  checkpoint_file(),
+  checkpoint_interval( 60.0 ),
+  checkpoint_resume( 0 ),
+  checkpoint( this )
 {
   item_db_sources.assign( std::begin( default_item_db_sources ),
                           std::end( default_item_db_sources ) );
@@ -1451,6 +1534,8 @@ sim_t::sim_t() :
   create_options();
 
   profileset::create_options( this );
+
+  checkpoint::create_options( this );
 }
 
 sim_t::sim_t( sim_t* p, int index ) : sim_t()
@@ -1511,6 +1596,12 @@ sim_t::sim_t( sim_t* p, int index, sim_control_t* control ) : sim_t()
 
 sim_t::~sim_t()
 {
+  // Profileset sims initialized ahead of time, but never simulated, are relatives of this sim
+  if ( ! parent )
+  {
+    profilesets.cancel();
+  }
+
   assert( ( requires_cleanup() && relatives.empty() ) || ! requires_cleanup() );
   if( parent )
     parent -> remove_relative( this );
@@ -1520,9 +1611,24 @@ sim_t::~sim_t()
 
 double sim_t::iteration_time_adjust() const
 {
+  // With rng streams, the combat length follows the claimed work item, like the rng stream of the
+  // iteration, so that every iteration is simulated identically regardless of the thread count.
+  if ( iteration_rng_streams && work_chunk.ticket >= 0 )
+  {
+    if ( combat_length_sampling != LENGTH_SAMPLING_SWEEP )
+      return 1.0 + vary_combat_length * ( 2.0 * combat_length_sample - 1.0 );
+
+    auto total = work_queue -> progress( as<int>( work_chunk.index ) ).total_iterations;
+    sim_progress_t progress { work_chunk.ticket, std::max( total, 1 ) };
+    return 1.0 + vary_combat_length * ( ( work_chunk.ticket % 2 ) ? 1 : -1 ) * progress.pct();
+  }
+
   if ( iterations <= 1 )
     return 1.0;
 
+  if ( combat_length_sampling != LENGTH_SAMPLING_SWEEP )
+    return 1.0 + vary_combat_length * ( 2.0 * combat_length_sample - 1.0 );
+
   if ( current_iteration == 0 )
     return 1.0;
 
@@ -1530,6 +1636,47 @@ double sim_t::iteration_time_adjust() const
   return 1.0 + vary_combat_length * ( ( current_iteration % 2 ) ? 1 : -1 ) * progress.pct();
 }
 
+// sim_t::combat_length_sampling_string =====================================
+
+const char* sim_t::combat_length_sampling_string() const
+{
+  switch ( combat_length_sampling )
+  {
+    case LENGTH_SAMPLING_RANDOM:     return "random";
+    case LENGTH_SAMPLING_STRATIFIED: return "stratified";
+    default:                         return "sweep";
+  }
+}
+
+// sim_t::draw_combat_length_sample =========================================
+
+/**
+ * Position of the combat length of the current iteration in the variation range. Stratified
+ * sampling uses the iteration's work item with rng streams, so that the combat lengths cover the
+ * range evenly regardless of the thread count, and are identical between paired sims. Otherwise
+ * each thread runs through the sequence by its own iterations, offset by a thread specific
+ * rotation so that the threads do not repeat each other's lengths.
+ */
+double sim_t::draw_combat_length_sample()
+{
+  switch ( combat_length_sampling )
+  {
+    case LENGTH_SAMPLING_RANDOM:
+      return rng().real();
+    case LENGTH_SAMPLING_STRATIFIED:
+    {
+      if ( iteration_rng_streams )
+        return radical_inverse( static_cast<uint64_t>( std::max( work_chunk.ticket, 0 ) ) );
+
+      double sample = radical_inverse( static_cast<uint64_t>( std::max( current_iteration, 0 ) ) ) +
+                      thread_index * 0.6180339887498949;
+      return sample - std::floor( sample );
+    }
+    default:
+      return 0.5;
+  }
+}
+
 // sim_t::expected_max_time =================================================
 
 double sim_t::expected_max_time() const
@@ -1588,9 +1735,13 @@ void sim_t::cancel()
 
   canceled = 1;
 
-  for (auto & relative : relatives)
   {
-    relative -> cancel();
+    // Profileset init threads add relatives concurrently
+    AUTO_LOCK( relatives_mutex );
+    for (auto & relative : relatives)
+    {
+      relative -> cancel();
+    }
   }
 
   if ( ! parent )
@@ -1651,11 +1802,14 @@ void sim_t::reset()
   if ( debug )
     out_debug << "Resetting Simulator";
 
-  if( deterministic )
+  if( deterministic && ! iteration_rng_streams )
     seed = rng().reseed();
 
   event_mgr.reset();
 
+  if ( vary_combat_length > 0 )
+    combat_length_sample = draw_combat_length_sample();
+
   expected_iteration_time = max_time * iteration_time_adjust();
 
   analyze_number = 0;
@@ -1889,7 +2043,11 @@ void sim_t::datacollection_begin()
       p -> datacollection_begin();
     }
   }
-  make_event<resource_timeline_collect_event_t>( *this, *this );
+
+  if ( ! lean_collection )
+  {
+    make_event<resource_timeline_collect_event_t>( *this, *this );
+  }
 }
 
 // sim_t::datacollection_end ================================================
@@ -1936,7 +2094,7 @@ void sim_t::datacollection_end()
   if ( deterministic && report_iteration_data > 0 && current_iteration > 0 && current_time() > timespan_t::zero() )
   {
     // TODO: Metric should be selectable
-    iteration_data_entry_t entry( iteration_dmg / current_time().total_seconds(), seed, current_iteration );
+    iteration_data_entry_t entry( iteration_dmg / current_time().total_seconds(), iteration_seed(), current_iteration );
     for ( size_t i = 0, end = target_list.size(); i < end; ++i )
     {
       const player_t* t = target_list[ i ];
@@ -1951,10 +2109,10 @@ void sim_t::datacollection_end()
     }
 
     if ( std::find_if( iteration_data.begin(), iteration_data.end(),
-                       seed_predicate_t( seed ) ) != iteration_data.end() )
+                       seed_predicate_t( entry.seed ) ) != iteration_data.end() )
     {
       errorf( "[Thread-%d] Duplicate seed %llu found on iteration %u, skipping ...",
-          thread_index, seed, current_iteration );
+          thread_index, entry.seed, current_iteration );
     }
     else
     {
@@ -1972,7 +2130,7 @@ void sim_t::analyze_error()
   if ( current_iteration < 1 ) return;
 
   int n_iterations = work_queue -> progress().current_iterations;
-  if ( strict_work_queue )
+  if ( private_work_queues() )
   {
     range::for_each( children, [ &n_iterations ]( sim_t* c ) {
       n_iterations += c -> work_queue -> progress().current_iterations;
@@ -1991,19 +2149,43 @@ void sim_t::analyze_error()
 
   current_error = 0;
 
+  // Combine the running target metric moments of this thread with the ones published by the
+  // child threads
+  auto target_metric = [ this ]( const player_collected_data_t& cd ) {
+    streaming_sample_data_t moments = cd.target_metric_moments;
+    if ( cd.thread_target_metric )
+    {
+      for ( int i = 1; i < threads; ++i )
+      {
+        moments.merge( cd.thread_target_metric[ i ].read() );
+      }
+    }
+    return moments;
+  };
+
+  // With stratified_target_error, stratified combat lengths remove the share of the metric
+  // variance explained by the combat length from the error of the mean. The share is estimated
+  // from the iterations of this thread.
+  auto mean_error = [ this ]( const player_collected_data_t& cd, const streaming_sample_data_t& moments ) {
+    double error = sim_t::distribution_mean_error( *this, moments );
+    if ( stratified_target_error && combat_length_sampling == LENGTH_SAMPLING_STRATIFIED &&
+         cd.combat_length_metric.count() >= 100 )
+    {
+      error *= std::sqrt( 1.0 - cd.combat_length_metric.explained_variance() );
+    }
+    return error;
+  };
+
   if ( single_actor_batch )
   {
     auto p = player_no_pet_list[ current_index ];
-    auto& cd = p -> collected_data;
-    AUTO_LOCK( cd.target_metric_mutex );
-    if ( cd.target_metric.size() != 0 )
+    auto moments = target_metric( p -> collected_data );
+    if ( moments.count() != 0 )
     {
-      cd.target_metric.analyze_basics();
-      cd.target_metric.analyze_variance();
-      current_mean = cd.target_metric.mean();
+      current_mean = moments.mean();
       if ( current_mean != 0 )
       {
-        current_error = sim_t::distribution_mean_error( *this, cd.target_metric ) / current_mean;
+        current_error = mean_error( p -> collected_data, moments ) / current_mean;
       }
     }
   }
@@ -2012,16 +2194,13 @@ void sim_t::analyze_error()
     for ( size_t i = 0; i < actor_list.size(); i++ )
     {
       player_t* p = actor_list[i];
-      player_collected_data_t& cd = p -> collected_data;
-      AUTO_LOCK( cd.target_metric_mutex );
-      if ( cd.target_metric.size() != 0 )
+      auto moments = target_metric( p -> collected_data );
+      if ( moments.count() != 0 )
       {
-        cd.target_metric.analyze_basics();
-        cd.target_metric.analyze_variance();
-        double mean = cd.target_metric.mean();
+        double mean = moments.mean();
         if ( mean != 0 )
         {
-          double error = sim_t::distribution_mean_error( *this, cd.target_metric ) / mean;
+          double error = mean_error( p -> collected_data, moments ) / mean;
           if ( error > current_error ) current_error = error;
           mean_total += mean;
           mean_count++;
@@ -2047,7 +2226,7 @@ void sim_t::analyze_error()
     {
       auto projected_iterations = static_cast<int>( n_iterations * ( ( current_error * current_error ) /
           ( target_error *  target_error ) ) );
-      if ( ! strict_work_queue )
+      if ( ! private_work_queues() )
       {
         work_queue -> project( projected_iterations );
       }
@@ -2404,7 +2583,8 @@ bool sim_t::init()
     }
   }
   _rng = rng::create( rng::parse_type( rng_str ) );
-  _rng -> seed( seed + thread_index );
+  // Threads of a counter based rng share the seed, their iterations use separate streams
+  _rng -> seed( iteration_rng_streams ? seed : seed + thread_index );
 
   if (   queue_lag_stddev == timespan_t::zero() )   queue_lag_stddev =   queue_lag * 0.25;
   if (     gcd_lag_stddev == timespan_t::zero() )     gcd_lag_stddev =     gcd_lag * 0.25;
@@ -2562,6 +2742,8 @@ bool sim_t::init()
     }
   }
 
+  checkpoint.init();
+
   profilesets.initialize( this );
 
   initialized = true;
@@ -2593,8 +2775,58 @@ void sim_t::analyze()
     std::cout << "Analyzing actor data ..." << std::endl;
   }
 
-  for ( size_t i = 0; i < actor_list.size(); i++ )
-    actor_list[ i ] -> analyze( *this );
+  // Actors are analyzed in parallel. Pets are analyzed by the same thread as their owner, after
+  // it, since the owner analysis covers the stats and gains of its pets.
+  std::vector<std::vector<player_t*>> actor_groups;
+  std::unordered_map<const player_t*, size_t> owner_group;
+  for ( auto actor : actor_list )
+  {
+    const player_t* owner = actor;
+    while ( owner -> is_pet() )
+    {
+      owner = owner -> cast_pet() -> owner;
+    }
+
+    auto it = owner_group.find( owner );
+    if ( it == owner_group.end() )
+    {
+      it = owner_group.insert( std::make_pair( owner, actor_groups.size() ) ).first;
+      actor_groups.emplace_back();
+    }
+
+    actor_groups[ it -> second ].push_back( actor );
+  }
+
+  thread::parallel_for( actor_groups.size(), report_thread_count(), [ this, &actor_groups ]( size_t i ) {
+    range::for_each( actor_groups[ i ], [ this ]( player_t* actor ) { actor -> analyze( *this ); } );
+  } );
+
+  // Actor Lists, in actor order
+  for ( auto actor : actor_list )
+  {
+    if ( actor -> quiet || actor -> collected_data.fight_length.mean() == 0 )
+      continue;
+
+    if ( actor -> is_pet() && report_pets_separately )
+      continue;
+
+    if ( ! actor -> is_enemy() && ! actor -> is_add() )
+    {
+      players_by_dps.push_back( actor );
+      players_by_priority_dps.push_back( actor );
+      players_by_hps.push_back( actor );
+      players_by_hps_plus_aps.push_back( actor );
+      players_by_dtps.push_back( actor );
+      players_by_tmi.push_back( actor );
+      players_by_name.push_back( actor );
+      players_by_apm.push_back( actor );
+      players_by_variance.push_back( actor );
+    }
+    else
+    {
+      targets_by_name.push_back( actor );
+    }
+  }
 
   range::sort( players_by_dps,  compare_dps() );
   range::sort( players_by_priority_dps, compare_priority_dps() );
@@ -2643,6 +2875,33 @@ void sim_t::analyze_iteration_data()
 }
 
 
+// sim_t::claim_iteration ===================================================
+
+/**
+ * Claim the work item of the next iteration from the work queue, moving on to
+ * the next index in single actor batch mode. The position of the work item
+ * selects the rng stream of the iteration, so that every iteration is
+ * simulated identically regardless of the thread that picks it up.
+ */
+bool sim_t::claim_iteration()
+{
+  while ( true )
+  {
+    size_t index = work_queue -> pop( work_chunk );
+    if ( work_chunk.ticket >= 0 )
+    {
+      current_index = work_chunk.index;
+      return true;
+    }
+
+    if ( ! work_queue -> more_work( work_chunk ) )
+    {
+      current_index = index;
+      return false;
+    }
+  }
+}
+
 // sim_t::iterate ===========================================================
 
 bool sim_t::iterate()
@@ -2652,14 +2911,30 @@ bool sim_t::iterate()
 
   progress_bar.init();
 
+  // With rng streams, every iteration claims its work item before it starts
+  bool more_work = ! iteration_rng_streams || claim_iteration();
+
   activate_actors();
 
-  bool more_work = true;
-  do
+  while ( more_work && ! canceled )
   {
     ++current_iteration;
     ++work_done;
 
+    if ( iteration_rng_streams )
+    {
+      iteration_stream = ( static_cast<uint64_t>( current_index ) << 32 ) | static_cast<uint32_t>( work_chunk.ticket );
+      if ( antithetic_sampling )
+      {
+        rng().stream( iteration_stream & ~uint64_t( 1 ) );
+        rng().antithetic( ( iteration_stream & 1 ) != 0 );
+      }
+      else
+      {
+        rng().stream( iteration_stream );
+      }
+    }
+
     combat();
 
     if ( progress_bar.update( false, as<int>(current_index) ) )
@@ -2671,8 +2946,15 @@ bool sim_t::iterate()
     auto old_active = current_index;
     if ( ! canceled )
     {
-      current_index = work_queue -> pop();
-      more_work = work_queue -> more_work();
+      if ( iteration_rng_streams )
+      {
+        more_work = claim_iteration();
+      }
+      else
+      {
+        current_index = work_queue -> pop( work_chunk );
+        more_work = work_queue -> more_work( work_chunk );
+      }
 
       if ( more_work && current_index != old_active )
       {
@@ -2688,7 +2970,9 @@ bool sim_t::iterate()
         activate_actors();
       }
     }
-  } while ( more_work && ! canceled );
+  }
+
+  work_finish_time = util::wall_time();
 
   if ( ! canceled && progress_bar.update( true, as<int>(current_index) ) )
   {
@@ -2709,7 +2993,8 @@ bool sim_t::iterate()
 
   iterations = current_iteration + 1;
 
-  return iterations > 0;
+  // With rng streams, a thread may find all work claimed before it starts
+  return iterations > 0 || iteration_rng_streams;
 }
 
 /**
@@ -2720,6 +3005,8 @@ bool sim_t::iterate()
  * practice all iterations do enough work for it not to matter.
  *
  * Lock/unlock is done per iteration, so processing cost should be minimal.
+ * Cancel and interrupt requests of the SIGINT handler are carried out here as
+ * well, by the first simulator thread to finish an iteration.
  */
 void sim_t::do_pause()
 {
@@ -2734,26 +3021,27 @@ void sim_t::do_pause()
       pause_mutex -> lock();
       pause_mutex -> unlock();
     }
+
+    if ( cancel_requested.exchange( false ) )
+    {
+      cancel();
+    }
+
+    if ( interrupt_requested.exchange( false ) )
+    {
+      errorf( "\nSimulation has been interrupted, reporting the iterations done so far\n" );
+      interrupt();
+    }
   }
 }
 
-/// merge sims
+/// merge the sim-wide data of a thread
 void sim_t::merge( sim_t& other_sim )
 {
-  auto_lock_t auto_lock( merge_mutex );
-  auto start = std::chrono::high_resolution_clock::now();
-
-  if ( scaling -> scale_stat == STAT_NONE &&
-       scaling -> calculate_scale_factors == 0 &&
-       plot -> dps_plot_stat_str.empty() &&
-       reforge_plot -> reforge_plot_stat_str.empty() &&
-       profileset_map.size() == 0 && ! profileset_enabled )
-  {
-    std::cout << "Merging data from thread-" << other_sim.thread_index << " ..." << std::endl;
-  }
-
   iterations += other_sim.iterations;
   work_per_thread[ other_sim.thread_index ] = other_sim.work_done;
+  wait_time_per_thread[ other_sim.thread_index ] = other_sim.work_finish_time;
+  event_memory_per_thread[ other_sim.thread_index ] = other_sim.event_mgr.allocated_bytes();
 
   simulation_length.merge( other_sim.simulation_length );
   total_dmg.merge( other_sim.total_dmg );
@@ -2764,61 +3052,120 @@ void sim_t::merge( sim_t& other_sim )
   raid_aps.merge( other_sim.raid_aps );
   event_mgr.merge( other_sim.event_mgr );
 
-  for ( auto & buff : buff_list )
+  // Sims are initialized from the same input, so the buff lists line up by
+  // index. Fall back to a lookup for buffs created on demand.
+  for ( size_t i = 0; i < buff_list.size(); ++i )
   {
-    if ( buff_t* otherbuff = buff_t::find( &other_sim, buff -> name_str.c_str() ) )
+    buff_t* buff = buff_list[ i ];
+    buff_t* otherbuff = nullptr;
+    if ( i < other_sim.buff_list.size() && other_sim.buff_list[ i ] -> name_str == buff -> name_str )
     {
-      buff -> merge( *otherbuff );
+      otherbuff = other_sim.buff_list[ i ];
+    }
+    else
+    {
+      otherbuff = buff_t::find( &other_sim, buff -> name_str.c_str() );
     }
-  }
 
-  for ( auto & player : actor_list )
-  {
-    player_t* other_p = other_sim.find_player( player -> index );
-    assert( other_p );
-    player -> merge( *other_p );
+    if ( otherbuff )
+    {
+      buff -> merge( *otherbuff );
+    }
   }
 
   range::append( iteration_data, other_sim.iteration_data );
-  merge_time += util::duration_fp_seconds( start );
   init_time += other_sim.init_time;
 }
 
-/// merge all sims together
+/**
+ * @brief Merge the results of all threads into this sim
+ *
+ * Everything is merged directly into the main sim, whose lists decide what
+ * is merged, so entries a thread created on demand are never lost on the
+ * way. Sim-wide data is merged thread by thread. Actors are independent of
+ * each other, so they are merged in parallel, each from all threads in
+ * thread order. Threads whose simulation failed are not merged.
+ */
 void sim_t::merge()
 {
   work_per_thread[ thread_index ] = work_done;
+  wait_time_per_thread[ thread_index ] = work_finish_time;
+  event_memory_per_thread[ thread_index ] = event_mgr.allocated_bytes();
 
   if ( children.empty() )
+  {
+    wait_time_per_thread[ thread_index ] = 0;
+    if ( measure_memory )
+    {
+      merge_memory = computer_process::memory_usage();
+    }
     return;
+  }
 
-  merge_mutex.unlock();
+  std::vector<sim_t*> merged_sims;
+  for ( auto& child : children )
+  {
+    child -> join();
+    if ( child -> iterate_successful )
+    {
+      merged_sims.push_back( child );
+    }
+  }
 
-  for ( size_t i = 0; i < children.size(); i++ )
+  // All thread sims are done collecting data, and not yet deleted
+  if ( measure_memory )
   {
-    sim_t* child = children[ i ];
-    if ( child )
+    merge_memory = computer_process::memory_usage();
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+
+  range::for_each( merged_sims, [ this ]( sim_t* child ) { merge( *child ); } );
+
+  thread::parallel_for( actor_list.size(), as<unsigned>( threads ), [ this, &merged_sims ]( size_t i ) {
+    player_t* player = actor_list[ i ];
+    for ( auto child : merged_sims )
     {
-      child -> join();
-      children[ i ] = nullptr;
-      if ( requires_cleanup() )
+      // The actor lists line up by index, fall back to a lookup otherwise
+      player_t* other_p = nullptr;
+      if ( i < child -> actor_list.size() && child -> actor_list[ i ] -> index == player -> index )
       {
-        delete child;
+        other_p = child -> actor_list[ i ];
       }
+      else
+      {
+        other_p = child -> find_player( player -> index );
+      }
+      assert( other_p );
+      player -> merge( *other_p );
+    }
+  } );
+
+  merge_time = util::duration_fp_seconds( start );
+
+  for ( auto& child : children )
+  {
+    if ( requires_cleanup() )
+    {
+      delete child;
     }
   }
 
   children.clear();
+
+  // Convert finish times to the time each thread idled before the last thread finished
+  double last_finish = *std::max_element( wait_time_per_thread.begin(), wait_time_per_thread.end() );
+  for ( auto& t : wait_time_per_thread )
+  {
+    t = last_finish - t;
+  }
 }
 
 // sim_t::run ===============================================================
 
 void sim_t::run()
 {
-  if( iterate() )
-  {
-    parent -> merge( *this );
-  }
+  iterate_successful = iterate();
 }
 
 // sim_t::partition =========================================================
@@ -2834,8 +3181,6 @@ void sim_t::partition()
 
   thread::set_main_thread_priority();
 
-  merge_mutex.lock(); // parent sim is locked until parent merge() is called
-
   int remainder = iterations % threads;
   iterations /= threads;
 
@@ -2843,7 +3188,9 @@ void sim_t::partition()
   // However, when we desire deterministic runs (for debugging) we need to force the
   // sims to each use a specific number of iterations as opposed to using shared pool of work.
 
-  if ( deterministic || strict_work_queue )
+  // Counter based rng streams are keyed by the work item, so they always use the shared queue.
+  bool private_queues = private_work_queues();
+  if ( private_queues )
   {
     work_queue -> init( iterations );
   }
@@ -2863,6 +3210,8 @@ void sim_t::partition()
     child_control = control;
   }
 
+  // Thread children are set up from options and initialized in their own threads. Only profileset
+  // sims reuse the initialization done ahead of time (see profileset::profilesets_t).
   for ( int i = 0; i < num_children; i++ )
   {
     auto  child = new sim_t( this, i + 1, child_control );
@@ -2877,7 +3226,7 @@ void sim_t::partition()
       remainder--;
     }
 
-    if( deterministic || strict_work_queue )
+    if( private_queues )
     {
       child -> work_queue -> init( child -> iterations );
     }
@@ -2886,10 +3235,25 @@ void sim_t::partition()
       child -> work_queue = work_queue;
     }
     child -> report_progress = 0;
+
+    // Inherit collection settings, profileset sims set these outside of the config file
+    child -> report_details = report_details;
+    child -> statistics_level = statistics_level;
+    child -> buff_uptime_timeline = buff_uptime_timeline;
+    child -> lean_collection = lean_collection;
   }
 
   computer_process::set_priority( process_priority ); // Set main thread priority
 
+  // Child threads publish their target metric moments to the main thread's actors
+  if ( target_error > 0 )
+  {
+    for ( auto& player : actor_list )
+    {
+      player -> collected_data.thread_target_metric.reset( new published_sample_data_t[ threads ] );
+    }
+  }
+
   for ( auto & child : children )
     child -> launch();
 
@@ -2910,6 +3274,7 @@ bool sim_t::execute()
 
   partition();
   bool success = iterate();
+  iterate_successful = success;
   merge(); // Always merge, even in cases of unsuccessful simulation!
   if( success )
     analyze();
@@ -3167,8 +3532,11 @@ void sim_t::create_options()
   add_option( opt_timespan( "max_time", max_time, timespan_t::zero(), timespan_t::max() ) );
   add_option( opt_bool( "fixed_time", fixed_time ) );
   add_option( opt_float( "vary_combat_length", vary_combat_length, 0.0, 1.0 ) );
+  add_option( opt_func( "combat_length_sampling", parse_combat_length_sampling ) );
+  add_option( opt_bool( "stratified_target_error", stratified_target_error ) );
   add_option( opt_func( "ptr", parse_ptr ) );
   add_option( opt_int( "threads", threads ) );
+  add_option( opt_int( "report_threads", report_threads ) );
   add_option( opt_float( "confidence", confidence, 0.0, 1.0 ) );
   add_option( opt_func( "spell_query", parse_spell_query ) );
   add_option( opt_string( "spell_query_xml_output_file", spell_query_xml_output_file_str ) );
@@ -3178,7 +3546,9 @@ void sim_t::create_options()
   add_option( opt_int( "stat_cache", stat_cache ) );
   add_option( opt_int( "max_aoe_enemies", max_aoe_enemies ) );
   add_option( opt_bool( "optimize_expressions", optimize_expressions ) );
+  add_option( opt_bool( "compile_expressions", compile_expressions ) );
   add_option( opt_bool( "single_actor_batch", single_actor_batch ) );
+  add_option( opt_bool( "lean_collection", lean_collection ) );
   add_option( opt_bool( "progressbar_type", progressbar_type ) );
   // Raid buff overrides
   add_option( opt_func( "optimal_raid", parse_optimal_raid ) );
@@ -3238,6 +3608,9 @@ void sim_t::create_options()
   add_option( opt_string( "rng", rng_str ) );
   add_option( opt_bool( "deterministic", deterministic ) );
   add_option( opt_bool( "strict_work_queue", strict_work_queue ) );
+  add_option( opt_bool( "paired_sampling", paired_sampling ) );
+  add_option( opt_bool( "antithetic_sampling", antithetic_sampling ) );
+  add_option( opt_int( "work_queue_chunk_size", work_queue_chunk_size, 1, std::numeric_limits<int>::max() ) );
   add_option( opt_float( "report_iteration_data", report_iteration_data ) );
   add_option( opt_int( "min_report_iteration_data", min_report_iteration_data ) );
   add_option( opt_bool( "average_range", average_range ) );
@@ -3250,6 +3623,7 @@ void sim_t::create_options()
   add_option( opt_float( "wheel_granularity", event_mgr.wheel_granularity ) );
   add_option( opt_int( "wheel_seconds", event_mgr.wheel_seconds ) );
   add_option( opt_int( "wheel_shift", event_mgr.wheel_shift ) );
+  add_option( opt_func( "event_queue", parse_event_queue ) );
   add_option( opt_string( "reference_player", reference_player_str ) );
   add_option( opt_string( "raid_events", raid_events_str ) );
   add_option( opt_append( "raid_events+", raid_events_str ) );
@@ -3313,6 +3687,7 @@ void sim_t::create_options()
   add_option( opt_bool( "save_talent_str", save_talent_str ) );
   add_option( opt_func( "talent_format", parse_talent_format ) );
   add_option( opt_int( "armory_retries", armory_retries ) );
+  add_option( opt_int( "http_concurrency", http_concurrency, 1, 64 ) );
   // Stat Enchants
   add_option( opt_float( "default_enchant_strength", enchant.attribute[ATTR_STRENGTH] ) );
   add_option( opt_float( "default_enchant_agility", enchant.attribute[ATTR_AGILITY] ) );
@@ -3397,10 +3772,10 @@ bool sim_t::parse_option( const std::string& name,
                           const std::string& value )
 {
   if ( active_player )
-    if ( opts::parse( this, active_player -> options, name, value ) )
+    if ( active_player -> options_index.parse( this, active_player -> options, name, value ) )
       return true;
 
-  if ( opts::parse( this, options, name, value ) )
+  if ( options_index.parse( this, options, name, value ) )
     return true;
 
   return false;
@@ -3451,7 +3826,7 @@ void sim_t::setup( sim_control_t* c )
       s << "Unable to locate player '" << o.scope << "' for option '" << o.name << "' with value '" << o.value << "'";
       throw std::invalid_argument( s.str() );
     }
-    if ( ! opts::parse(this, p->options, o.name, o.value))
+    if ( ! p -> options_index.parse( this, p -> options, o.name, o.value ) )
     {
       std::stringstream s;
       s << "Unable to parse option '" << o.name << "' with value '" << o.value
@@ -3543,11 +3918,27 @@ void sim_t::setup( sim_control_t* c )
     work_queue -> batches( player_no_pet_list.size() );
   }
   work_queue -> init( iterations );
-  if ( thread_index == 0 )
+  work_queue -> chunk_size = work_queue_chunk_size;
+
+  // Paired and antithetic sampling select the random numbers of an iteration by its work item,
+  // which requires a counter based rng engine
+  if ( ( paired_sampling || antithetic_sampling ) &&
+       ! rng::counter_based( rng::parse_type( rng_str ) ) )
   {
-    work_per_thread.resize( threads );
+    if ( rng::parse_type( rng_str ) != rng::engine_type::DEFAULT )
+    {
+      errorf( "Paired and antithetic sampling require a counter based rng, overriding rng=%s with rng=philox.",
+              rng_str.c_str() );
+    }
+    rng_str = "philox";
   }
 
+  // Counter based rng engines give each iteration its own stream
+  iteration_rng_streams = rng::counter_based( rng::parse_type( rng_str ) );
+  work_per_thread.resize( threads );
+  wait_time_per_thread.resize( threads );
+  event_memory_per_thread.resize( threads );
+
   if( deterministic && ( target_error != 0 ) )
   {
     errorf( "deterministic=1 cannot be used with non-zero target_error values!\n" );
@@ -3562,13 +3953,13 @@ sim_progress_t sim_t::progress( std::string* detailed, int index )
 
   // If strict work queue is used with target error, estimate that total iterations will be roughly
   // the total iterations of the main thread, multiplied by the total number of threads.
-  if ( target_error > 0 && strict_work_queue )
+  if ( target_error > 0 && private_work_queues() )
   {
     total_progress.total_iterations *= threads;
   }
 
   // For work queues that are independent, collect all work done so far for the progressbar.
-  if ( deterministic || strict_work_queue )
+  if ( private_work_queues() )
   {
     AUTO_LOCK( relatives_mutex );
     for ( const auto& child : children )
@@ -3650,6 +4041,10 @@ void sim_t::errorf( const char* fmt, ... )
   va_end( fmtargs );
 
   util::replace_all( s, "\n", "" );
+
+  // Actors are merged and analyzed in parallel
+  AUTO_LOCK( error_mutex );
+
   std::cerr << s << "\n";
 
   error_list.push_back( s );
@@ -3674,7 +4069,12 @@ void sim_t::abort()
 /// add chart to sim for end of report processing
 void sim_t::add_chart_data( const highchart::chart_t& chart )
 {
-  if ( chart.toggle_id_str_.empty() )
+  if ( active_chart_capture )
+  {
+    active_chart_capture -> data.emplace_back( chart.toggle_id_str_,
+        chart.toggle_id_str_.empty() ? chart.to_aggregate_string( false ) : chart.to_data() );
+  }
+  else if ( chart.toggle_id_str_.empty() )
   {
     on_ready_chart_data.push_back( chart.to_aggregate_string( false ) );
   }
@@ -3684,6 +4084,32 @@ void sim_t::add_chart_data( const highchart::chart_t& chart )
   }
 }
 
+void sim_t::chart_capture_t::add_to( sim_t& sim ) const
+{
+  for ( const auto& chart : data )
+  {
+    if ( chart.first.empty() )
+    {
+      sim.on_ready_chart_data.push_back( chart.second );
+    }
+    else
+    {
+      sim.chart_data[ chart.first ].push_back( chart.second );
+    }
+  }
+}
+
+sim_t::chart_capture_scope_t::chart_capture_scope_t( chart_capture_t& capture ) :
+  previous( active_chart_capture )
+{
+  active_chart_capture = &capture;
+}
+
+sim_t::chart_capture_scope_t::~chart_capture_scope_t()
+{
+  active_chart_capture = previous;
+}
+
 void sim_t::print_spell_query()
 {
   if ( ! spell_query_xml_output_file_str.empty() )
@@ -3755,16 +4181,26 @@ std::vector<double> sc_timeline_t::build_divisor_timeline( const extended_sample
  */
 void sc_timeline_t::adjust( sim_t& sim )
 {
-  // Check if we have divisor timeline cached
-  auto it = sim.divisor_timeline_cache.find( bin_size );
-  if ( it == sim.divisor_timeline_cache.end() )
+  const std::vector<double>* divisor_timeline;
+
   {
-    // If we don't have a cached divisor timeline, build one
-    sim.divisor_timeline_cache[ bin_size ] = build_divisor_timeline( sim.simulation_length, bin_size );
+    AUTO_LOCK( sim.divisor_timeline_mutex );
+
+    // Check if we have divisor timeline cached
+    auto it = sim.divisor_timeline_cache.find( bin_size );
+    if ( it == sim.divisor_timeline_cache.end() )
+    {
+      // If we don't have a cached divisor timeline, build one
+      it = sim.divisor_timeline_cache.insert( std::make_pair( bin_size,
+          build_divisor_timeline( sim.simulation_length, bin_size ) ) ).first;
+    }
+
+    // Map elements stay in place, the cached timeline can be used without holding the lock
+    divisor_timeline = &( it -> second );
   }
 
   // Do the timeline adjustement
-  base_t::adjust( sim.divisor_timeline_cache[ bin_size ] );
+  base_t::adjust( *divisor_timeline );
 }
 
 void sc_timeline_t::adjust( const extended_sample_data_t& adjustor )
@@ -3801,16 +4237,17 @@ sim_ostream_t& sim_ostream_t::printf( const char* fmt, ... )
 
 void sim_t::enable_debug_seed()
 {
+  auto current_seed = iteration_seed();
   auto enabled = false;
 
-  if ( debug_seed.size() == 1 && seed == debug_seed[ 0 ] )
+  if ( debug_seed.size() == 1 && current_seed == debug_seed[ 0 ] )
   {
     enabled = true;
   }
   else
   {
-    auto it = std::lower_bound( debug_seed.begin(), debug_seed.end(), seed );
-    enabled = it != debug_seed.end() && *it == seed;
+    auto it = std::lower_bound( debug_seed.begin(), debug_seed.end(), current_seed );
+    enabled = it != debug_seed.end() && *it == current_seed;
   }
 
   if ( enabled )
@@ -3822,7 +4259,7 @@ void sim_t::enable_debug_seed()
     }
 
     std::shared_ptr<io::ofstream> o(new io::ofstream());
-    std::string fname = output_file_str + "." + util::to_string( seed );
+    std::string fname = output_file_str + "." + util::to_string( current_seed );
     o -> open( fname );
     if ( o -> is_open() )
     {
@@ -3830,7 +4267,7 @@ void sim_t::enable_debug_seed()
       out_debug = o;
       out_log = o;
 
-      out_std.printf( "------ Iteration #%i (seed=%llu) ------", current_iteration, seed );
+      out_std.printf( "------ Iteration #%i (seed=%llu) ------", current_iteration, current_seed );
       std::flush( *out_std.get_stream() );
     }
     else
@@ -3851,16 +4288,17 @@ void sim_t::disable_debug_seed()
     return;
   }
 
+  auto current_seed = iteration_seed();
   auto enabled = false;
 
-  if ( debug_seed.size() == 1 && seed == debug_seed[ 0 ] )
+  if ( debug_seed.size() == 1 && current_seed == debug_seed[ 0 ] )
   {
     enabled = true;
   }
   else
   {
-    auto it = std::lower_bound( debug_seed.begin(), debug_seed.end(), seed );
-    enabled = it != debug_seed.end() && *it == seed;
+    auto it = std::lower_bound( debug_seed.begin(), debug_seed.end(), current_seed );
+    enabled = it != debug_seed.end() && *it == current_seed;
   }
 
   if ( enabled )
@@ -3871,6 +4309,13 @@ void sim_t::disable_debug_seed()
   }
 }
 
+// Seed of the current iteration, the iteration's rng stream with counter based rng streams, since
+// the sim seed is the same for every iteration then
+uint64_t sim_t::iteration_seed() const
+{
+  return iteration_rng_streams ? iteration_stream : seed;
+}
+
 // Activates the relevant actors in the simulator just before simulating, based on the relevant
 // simulation mode (single vs multi actor).
 void sim_t::activate_actors()
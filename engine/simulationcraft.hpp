@@ -142,6 +142,8 @@ namespace highchart {
 
 #include "sim/sc_profileset.hpp"
 
+#include "sim/sc_checkpoint.hpp"
+
 #include "player/artifact_data.hpp"
 
 // Legion-specific "pantheon trinket" system
@@ -1317,6 +1319,8 @@ struct progress_bar_t
   void init();
   bool update( bool finished = false, int index = -1 );
   void output( bool finished = false );
+  // Stream progress is written to, stderr when stdout carries the profileset stream
+  std::ostream& out() const;
   void restart();
   void progress();
   void set_base( const std::string& base );
@@ -1486,19 +1490,95 @@ private:
 
 struct event_manager_t
 {
+  /// Event queue implementations, selected through the "event_queue" sim option
+  enum queue_type_e
+  {
+    QUEUE_WHEEL,        /// Single timing wheel with sorted per-slice event lists (default)
+    QUEUE_HIERARCHICAL  /// Cascading multi-level timing wheel, O(1) insert for any horizon
+  };
+
+  /**
+   * Hierarchical (cascading) timing wheel.
+   *
+   * Level 0 has a granularity of one millisecond, so all events in a level 0
+   * slot share the same timestamp and are kept in FIFO order. Each higher level
+   * covers SLOTS times the range of the previous one. Events are placed on the
+   * level at which their timestamp first differs from the wheel cursor, and are
+   * cascaded one level down when the cursor enters their slot. Occupancy
+   * bitmaps allow skipping empty slots without scanning them. Events beyond the
+   * range of the top level are kept in an unsorted overflow list.
+   */
+  struct hierarchical_wheel_t
+  {
+    static const unsigned LEVELS = 5;
+    static const unsigned SLOT_BITS = 6;
+    static const unsigned SLOTS = 1U << SLOT_BITS;
+
+    event_t* head[ LEVELS ][ SLOTS ];
+    event_t* tail[ LEVELS ][ SLOTS ];
+    uint64_t occupied[ LEVELS ];
+    event_t* overflow;
+    event_t* overflow_tail;
+    uint64_t now;
+#ifdef EVENT_QUEUE_DEBUG
+    uint64_t n_cascaded, n_overflow;
+#endif /* EVENT_QUEUE_DEBUG */
+
+    hierarchical_wheel_t();
+    void insert( event_t* );
+    event_t* pop();
+    void clear();
+  private:
+    void append( unsigned level, unsigned slot, event_t* );
+    void cascade( unsigned level, unsigned slot );
+    void cascade_overflow();
+  };
+
+  /**
+   * Size class of the event allocator.
+   *
+   * Each class hands out fixed size blocks carved from contiguous slabs, and
+   * keeps recycled blocks of that size in its own free list. Every block is
+   * preceded by a small header recording the class it belongs to.
+   */
+  struct slab_class_t
+  {
+    std::size_t size;            /// Event (payload) size of blocks in this class
+    std::size_t blocks_per_slab;
+    std::size_t slab_used;       /// Blocks carved from the most recent slab
+    std::vector<char*> slabs;
+    event_t* free_list;
+    std::size_t merged_slabs;    /// Slabs allocated by merged (child) event managers
+
+    slab_class_t( std::size_t size );
+    std::size_t stride() const;
+    std::size_t slab_bytes() const;
+  };
+
+  /// Function event callable type moved to the heap, and the number of events created with it
+  struct fn_heap_site_t
+  {
+    std::size_t size;
+    uint64_t count;
+  };
+
   sim_t* sim;
   timespan_t current_time;
   uint64_t events_remaining;
   uint64_t events_processed;
   uint64_t total_events_processed;
   uint64_t max_events_remaining;
+  uint64_t fn_heap_allocations;
+  /// Heap allocating function events by the (mangled) type name of their callable
+  std::unordered_map<const char*, fn_heap_site_t> fn_heap_sites;
   unsigned timing_slice, global_event_id;
   std::vector<event_t*> timing_wheel;
-  event_t* recycled_event_list;
+  std::vector<slab_class_t> slab_classes;
   int    wheel_seconds, wheel_size, wheel_mask, wheel_shift;
   double wheel_granularity;
   timespan_t wheel_time;
-  std::vector<event_t*> allocated_events;
+  queue_type_e queue_type;
+  std::unique_ptr<hierarchical_wheel_t> hierarchical_wheel;
 
   stopwatch_t event_stopwatch;
   bool monitor_cpu;
@@ -1514,7 +1594,10 @@ struct event_manager_t
  ~event_manager_t();
   void* allocate_event( std::size_t size );
   void recycle_event( event_t* );
+  void record_fn_heap_allocation( const char* type_name, std::size_t size );
+  std::size_t allocated_bytes() const;
   void add_event( event_t*, timespan_t delta_time );
+  void add_event_wheel( event_t*, timespan_t delta_time );
   void reschedule_event( event_t* );
   event_t* next_event();
   bool execute();
@@ -1523,6 +1606,7 @@ struct event_manager_t
   void init();
   void reset();
   void merge( event_manager_t& other );
+  const char* queue_type_name() const;
 };
 
 // Simulation Engine ========================================================
@@ -1540,6 +1624,16 @@ struct sim_t : private sc_thread_t
   // Iteration Controls
   timespan_t max_time, expected_iteration_time;
   double vary_combat_length;
+  // Sampling of the combat length variation of the iterations: the default sweep over the
+  // simulation progress, independent random draws, or a stratified (low-discrepancy) sequence over
+  // the iteration index. Combat length sample is the position of the current iteration in the
+  // variation range, [0, 1).
+  enum combat_length_sampling_e { LENGTH_SAMPLING_SWEEP, LENGTH_SAMPLING_RANDOM, LENGTH_SAMPLING_STRATIFIED };
+  combat_length_sampling_e combat_length_sampling;
+  double combat_length_sample;
+  // Remove the share of the target metric variance explained by the combat length from the
+  // target_error convergence check (stratified sampling only)
+  bool stratified_target_error;
   int current_iteration, iterations;
   bool canceled;
   double target_error;
@@ -1583,7 +1677,7 @@ struct sim_t : private sc_thread_t
   double      travel_variance, default_skill;
   timespan_t  reaction_time, regen_periodicity;
   timespan_t  ignite_sampling_delta;
-  bool        fixed_time, optimize_expressions;
+  bool        fixed_time, optimize_expressions, compile_expressions;
   int         current_slot;
   int         optimal_raid, log, debug_each;
   std::vector<uint64_t> debug_seed;
@@ -1604,6 +1698,7 @@ struct sim_t : private sc_thread_t
   bool        single_actor_batch;
   int         progressbar_type;
   int         armory_retries;
+  int         http_concurrency; // Concurrent downloads of guild and item imports
 
   // Target options
   double      enemy_death_pct;
@@ -1641,12 +1736,23 @@ struct sim_t : private sc_thread_t
 
   std::unordered_map<std::string, std::string> var_map;
   std::vector<std::unique_ptr<option_t>> options;
+  opts::index_t options_index;
   std::vector<std::string> party_encoding;
   std::vector<std::string> item_db_sources;
 
   // Random Number Generation
   std::unique_ptr<rng::rng_t> _rng;
   std::string rng_str;
+  // Each iteration draws from its own stream of a counter based rng, keyed by the work item it
+  // claimed. Results are then independent of the thread count.
+  bool iteration_rng_streams;
+  // Stream of the current iteration, used to pair up iterations of different sims
+  uint64_t iteration_stream;
+  // Scale factor and profileset sims reuse the iteration streams of the baseline sim, and compare
+  // results through the paired differences of their iterations
+  int paired_sampling;
+  // Iterations with an odd work item mirror the random numbers of the preceding even one
+  int antithetic_sampling;
   uint64_t seed;
   int deterministic;
   int strict_work_queue;
@@ -1723,7 +1829,15 @@ struct sim_t : private sc_thread_t
   double elapsed_cpu;
   double elapsed_time;
   std::vector<size_t> work_per_thread;
+  // Time each thread spent waiting for the slowest thread to finish its work
+  std::vector<double> wait_time_per_thread;
+  double work_finish_time;
+  std::vector<size_t> event_memory_per_thread;
   size_t work_done;
+  // Resident memory of the process when the thread sims are merged, measured if requested
+  bool measure_memory;
+  size_t merge_memory;
+  bool iterate_successful;
   double     iteration_dmg, priority_iteration_dmg,  iteration_heal, iteration_absorb;
   simple_sample_data_t raid_dps, total_dmg, raid_hps, total_heal, total_absorb, raid_aps;
   extended_sample_data_t simulation_length;
@@ -1751,10 +1865,12 @@ struct sim_t : private sc_thread_t
   std::vector<player_t*> targets_by_name;
   std::vector<std::string> id_dictionary;
   std::map<double, std::vector<double> > divisor_timeline_cache;
+  mutex_t divisor_timeline_mutex; // Actors are analyzed in parallel
   std::string output_file_str, html_file_str, json_file_str, json2_file_str;
   std::string xml_file_str, xml_stylesheet_file_str;
   std::string reforge_plot_output_file_str;
   std::vector<std::string> error_list;
+  mutex_t error_mutex;
   int report_precision;
   int report_pets_separately;
   int report_targets;
@@ -1784,74 +1900,144 @@ struct sim_t : private sc_thread_t
   double scaling_normalized;
 
   // Multi-Threading
-  mutex_t merge_mutex;
   int threads;
+  // Threads generating the per-actor analysis and reports, serial by default, 0 uses threads
+  int report_threads;
   std::vector<sim_t*> children; // Manual delete!
   int thread_index;
   computer_process::priority_e process_priority;
+  // Lock-free work queue. Threads sharing the queue claim iterations in chunks through atomic
+  // counters, and run the claimed iterations without touching shared state until their chunk is
+  // used up. Threads that run out of work simply claim the next chunk from whatever is left, so
+  // faster threads take over work that would otherwise be assigned to slower ones.
   struct work_queue_t
   {
-    private:
-    mutex_t m;
-    public:
-    std::vector<int> _total_work, _work, _projected_work;
-    size_t index;
+    // Per-thread state of a claimed chunk of iterations
+    struct chunk_t
+    {
+      size_t index;
+      int remaining;
+      unsigned epoch;
+      // Position of the work item claimed by the last pop within its index, -1 if none was claimed
+      int ticket;
 
-    work_queue_t() : index( 0 )
-    { _total_work.resize( 1 ); _work.resize( 1 ); _projected_work.resize( 1 ); }
+      chunk_t() : index( 0 ), remaining( 0 ), epoch( 0 ), ticket( -1 )
+      { }
+    };
+
+    std::vector<std::atomic<int>> _total_work, _work, _projected_work;
+    // Incremented when the work of an index is flushed, invalidating chunks claimed for it
+    std::vector<std::atomic<unsigned>> _epoch;
+    std::atomic<size_t> index;
+    int chunk_size;
+
+    work_queue_t() : _total_work( 1 ), _work( 1 ), _projected_work( 1 ), _epoch( 1 ), index( 0 ),
+      chunk_size( 1 )
+    { }
 
-    void init( int w )    { AUTO_LOCK(m); range::fill( _total_work, w ); range::fill( _projected_work, w ); }
+    void init( int w )
+    {
+      for ( size_t i = 0; i < _total_work.size(); ++i )
+      {
+        _total_work[ i ] = _projected_work[ i ] = w;
+      }
+    }
     // Single actor batch sim init methods. Batches is the number of active actors
-    void batches( size_t n ) { AUTO_LOCK(m); _total_work.resize( n ); _work.resize( n ); _projected_work.resize( n ); }
+    void batches( size_t n )
+    {
+      _total_work = std::vector<std::atomic<int>>( n );
+      _work = std::vector<std::atomic<int>>( n );
+      _projected_work = std::vector<std::atomic<int>>( n );
+      _epoch = std::vector<std::atomic<unsigned>>( n );
+    }
 
-    void flush()          { AUTO_LOCK(m); _total_work[ index ] = _projected_work[ index ] = _work[ index ]; }
-    int  size()           { AUTO_LOCK(m); return index < _total_work.size() ? _total_work[ index ] : _total_work.back(); }
-    bool more_work()      { AUTO_LOCK(m); return index < _total_work.size() && _work[ index ] < _total_work[ index ]; }
+    void flush()
+    {
+      size_t idx = index;
+      _total_work[ idx ] = _projected_work[ idx ] = _work[ idx ].load();
+      ++_epoch[ idx ];
+    }
 
-    void project( int w )
+    int  size()           { size_t idx = index; return idx < _total_work.size() ? _total_work[ idx ] : _total_work.back(); }
+
+    bool more_work( const chunk_t& chunk )
     {
-      AUTO_LOCK(m);
-      _projected_work[ index ] = w;
-#ifdef NDEBUG
-      if ( w > _work[ index ] )
+      if ( chunk.remaining > 0 && chunk.epoch == _epoch[ chunk.index ] )
       {
+        return true;
       }
-#endif
+
+      size_t idx = index;
+      return idx < _total_work.size() && _work[ idx ] < _total_work[ idx ];
     }
 
-    // Single-actor batch pop, uses several indices of work (per active actor), each thread has it's
-    // own state on what index it is simulating
-    size_t pop()
+    void project( int w )
     {
-      AUTO_LOCK(m);
+      _projected_work[ index ] = w;
+    }
 
-      if ( _work[ index ] >= _total_work[ index ] )
+    // Account for a finished iteration, and return the index of the next one. Iterations are
+    // taken from the thread's current chunk, or a new chunk is claimed from the current index. In
+    // single-actor batch mode, the shared index advances once all work of an index is claimed.
+    size_t pop( chunk_t& chunk )
+    {
+      if ( chunk.remaining > 0 && chunk.epoch == _epoch[ chunk.index ] )
       {
-        if ( index < _work.size() - 1 )
-        {
-          ++index;
-        }
-        return index;
+        --chunk.remaining;
+        ++chunk.ticket;
+        return chunk.index;
       }
 
-      if ( ++_work[ index ] == _total_work[ index ] )
+      while ( true )
       {
-        _projected_work[ index ] = _work[ index ];
-        if ( index < _work.size() - 1 )
+        size_t idx = index;
+        int total = _total_work[ idx ];
+        int work = _work[ idx ];
+
+        if ( work >= total )
         {
-          ++index;
+          chunk.remaining = 0;
+          chunk.ticket = -1;
+          if ( idx < _work.size() - 1 && index.compare_exchange_strong( idx, idx + 1 ) )
+          {
+            return idx + 1;
+          }
+          return index;
         }
-        return index;
-      }
 
-      return index;
+        int n = std::min( std::max( chunk_size, 1 ), total - work );
+        unsigned epoch = _epoch[ idx ];
+        if ( ! _work[ idx ].compare_exchange_weak( work, work + n ) )
+        {
+          continue;
+        }
+
+        chunk.index = idx;
+        chunk.remaining = n - 1;
+        chunk.epoch = epoch;
+        chunk.ticket = work;
+
+        if ( work + n == total )
+        {
+          _projected_work[ idx ] = total;
+          if ( idx < _work.size() - 1 )
+          {
+            index.compare_exchange_strong( idx, idx + 1 );
+            if ( chunk.remaining == 0 )
+            {
+              return index;
+            }
+          }
+        }
+
+        return chunk.index;
+      }
     }
 
     // Standard progress method, normal mode sims use the single (first) index, single actor batch
     // sims progress with the main thread's current index.
     sim_progress_t progress( int idx = -1 )
     {
-      AUTO_LOCK(m);
       size_t current_index = idx;
       if ( idx < 0 )
       {
@@ -1867,6 +2053,8 @@ struct sim_t : private sc_thread_t
     }
   };
   std::shared_ptr<work_queue_t> work_queue;
+  work_queue_t::chunk_t work_chunk;
+  int work_queue_chunk_size;
 
   // Related Simulations
   mutex_t relatives_mutex;
@@ -1879,6 +2067,9 @@ struct sim_t : private sc_thread_t
 
   mutex_t* pause_mutex; // External pause mutex, instantiated an external entity (in our case the GUI).
   bool paused;
+  // Cancel and interrupt requests of the SIGINT handler. A signal handler cannot lock mutexes or
+  // join threads, so the simulator threads carry them out (see do_pause).
+  std::atomic<bool> cancel_requested, interrupt_requested;
 
   // Highcharts stuff
 
@@ -1890,6 +2081,25 @@ struct sim_t : private sc_thread_t
   // to correct elements (toggled elements in the HTML report) based on the data.
   std::map<std::string, std::vector<std::string> > chart_data;
 
+  // Chart data of a report part rendered off the report, in the order it was added. While a thread
+  // has a chart_capture_scope_t, its charts are collected to the capture instead of the report, so
+  // that the parts can be rendered in parallel, and their charts added to the report in order.
+  struct chart_capture_t
+  {
+    // Toggle id, chart data
+    std::vector<std::pair<std::string, std::string>> data;
+
+    void add_to( sim_t& sim ) const;
+  };
+
+  struct chart_capture_scope_t : private ::noncopyable
+  {
+    chart_capture_t* previous;
+
+    chart_capture_scope_t( chart_capture_t& capture );
+    ~chart_capture_scope_t();
+  };
+
   bool chart_show_relative_difference;
   double chart_boxplot_percentile;
 
@@ -1907,6 +2117,19 @@ struct sim_t : private sc_thread_t
   std::vector<std::string> profileset_output_data;
   bool profileset_enabled;
   int profileset_work_threads, profileset_init_threads;
+  int profileset_race_top, profileset_race_iterations;
+  double profileset_race_growth, profileset_race_confidence;
+  std::string profileset_cache_file;
+  std::string profileset_stream_file;
+  bool profileset_lean_collection;
+  // Collect only the data of the profileset metrics, profileset sims without reports use it
+  bool lean_collection;
+
+  // Checkpointing
+  std::string checkpoint_file;
+  double checkpoint_interval;
+  int checkpoint_resume;
+  checkpoint::checkpoint_t checkpoint;
 
   sim_t();
   sim_t( sim_t* parent, int thread_index = 0 );
@@ -1916,6 +2139,8 @@ struct sim_t : private sc_thread_t
   virtual void run() override;
   int       main( const std::vector<std::string>& args );
   double    iteration_time_adjust() const;
+  double    draw_combat_length_sample();
+  const char* combat_length_sampling_string() const;
   double    expected_max_time() const;
   bool      is_canceled() const;
   void      cancel_iteration();
@@ -1936,8 +2161,13 @@ struct sim_t : private sc_thread_t
   bool      init_actor_pets();
   bool      init();
   void      analyze();
+  unsigned  report_thread_count() const
+  { return static_cast<unsigned>( std::max( report_threads > 0 ? report_threads : threads, 1 ) ); }
   void      merge( sim_t& other_sim );
   void      merge();
+  bool      claim_iteration();
+  bool      private_work_queues() const
+  { return ( deterministic || strict_work_queue ) && ! iteration_rng_streams; }
   bool      iterate();
   void      partition();
   bool      execute();
@@ -1969,6 +2199,8 @@ struct sim_t : private sc_thread_t
   { return event_mgr.current_time; }
   static double distribution_mean_error( const sim_t& s, const extended_sample_data_t& sd )
   { return s.confidence_estimator * sd.mean_std_dev; }
+  static double distribution_mean_error( const sim_t& s, const streaming_sample_data_t& sd )
+  { return s.confidence_estimator * sd.mean_std_dev(); }
   void register_target_data_initializer(std::function<void(actor_target_data_t*)> cb)
   { target_data_initializer.push_back( cb ); }
   rng::rng_t& rng() const
@@ -1987,6 +2219,7 @@ private:
   void print_spell_query();
   void enable_debug_seed();
   void disable_debug_seed();
+  uint64_t iteration_seed() const;
   bool requires_cleanup() const;
 };
 
@@ -2090,6 +2323,10 @@ struct scaling_t
   std::string scale_only_str;
   stat_e current_scaling_stat;
   int num_scaling_stats, remaining_scaling_stats;
+  // Threads per stat sim when the stat sims run concurrently, 0 runs one stat at a time
+  int scale_factor_work_threads;
+  // Stat sims currently running concurrently
+  std::vector<sim_t*> active_sims;
   std::string scale_over;
   scale_metric_e scaling_metric;
   std::string scale_over_player;
@@ -2102,7 +2339,12 @@ struct scaling_t
   void init_deltas();
   void analyze();
   void analyze_stats();
+  void analyze_stats_concurrently( const std::vector<stat_e>& );
+  void analyze_stat_sims( stat_e, sim_t* ref, sim_t* delta );
+  void checkpoint_stat( stat_e );
+  bool resume_stat( stat_e );
   void analyze_ability_stats( stat_e, double, player_t*, player_t*, player_t* );
+  void output_progressbar( int done ) const;
   void analyze_lag();
   void normalize();
   double progress( std::string& phase, std::string* detailed = nullptr );
@@ -2262,40 +2504,73 @@ inline Event* make_event( sim_t& sim, Args&&... args )
 {
   static_assert( std::is_base_of<event_t, Event>::value,
                  "Event must be derived from event_t" );
-  auto r = new ( sim ) Event( args... );
+  auto r = new ( sim ) Event( std::forward<Args>( args )... );
   assert( r -> id != 0 && "Event not added to event manager!" );
   return r;
 }
 
-inline event_t* make_event( sim_t& s, const timespan_t& t, const std::function<void(void)>& f )
+/// Largest callable stored inline in a function event, larger ones are heap allocated
+const std::size_t FN_EVENT_MAX_INLINE_SIZE = 256;
+
+/**
+ * @brief Event executing an arbitrary callable
+ *
+ * The callable is stored inline in the event block, so creating the event does not
+ * allocate memory outside the event manager. Callables larger than
+ * FN_EVENT_MAX_INLINE_SIZE are moved to the heap instead.
+ */
+template <typename Fn, bool Inline = sizeof( Fn ) <= FN_EVENT_MAX_INLINE_SIZE>
+class fn_event_t : public event_t
 {
-  class fn_event_t : public event_t
-  {
-    std::function<void(void)> fn;
+  Fn fn;
 
-    public:
-      fn_event_t( sim_t& s, const timespan_t& t, const std::function<void(void)>& f ) :
-        event_t( s, t ), fn( f )
-      { }
+public:
+  fn_event_t( sim_t& s, const timespan_t& t, Fn&& f ) :
+    event_t( s, t ), fn( std::move( f ) )
+  { }
 
-      const char* name() const override
-      { return "function_event"; }
+  const char* name() const override
+  { return "function_event"; }
 
-      void execute() override
-      { fn(); }
-  };
+  void execute() override
+  { fn(); }
+};
 
-  return make_event<fn_event_t>( s, s, t, f );
+template <typename Fn>
+class fn_event_t<Fn, false> : public event_t
+{
+  std::unique_ptr<Fn> fn;
+
+public:
+  fn_event_t( sim_t& s, const timespan_t& t, Fn&& f ) :
+    event_t( s, t ), fn( new Fn( std::move( f ) ) )
+  { s.event_mgr.record_fn_heap_allocation( typeid( Fn ).name(), sizeof( Fn ) ); }
+
+  const char* name() const override
+  { return "function_event"; }
+
+  void execute() override
+  { ( *fn )(); }
+};
+
+template <typename Fn>
+inline event_t* make_event( sim_t& s, const timespan_t& t, Fn&& f )
+{
+  using fn_t = typename std::decay<Fn>::type;
+  return make_event<fn_event_t<fn_t>>( s, s, t, fn_t( std::forward<Fn>( f ) ) );
 }
 
-inline event_t* make_event( sim_t* s, const timespan_t& t, const std::function<void(void)>& f )
-{ return make_event( *s, t, f ); }
+template <typename Fn>
+inline event_t* make_event( sim_t* s, const timespan_t& t, Fn&& f )
+{ return make_event( *s, t, std::forward<Fn>( f ) ); }
 
-inline event_t* make_event( sim_t* s, const std::function<void(void)>& f )
-{ return make_event( *s, timespan_t::zero(), f ); }
+template <typename Fn>
+inline event_t* make_event( sim_t* s, Fn&& f )
+{ return make_event( *s, timespan_t::zero(), std::forward<Fn>( f ) ); }
 
-inline event_t* make_event( sim_t& s, const std::function<void(void)>& f )
-{ return make_event( s, timespan_t::zero(), f ); }
+template <typename Fn>
+inline event_t* make_event( sim_t& s, Fn&& f )
+{ return make_event( s, timespan_t::zero(), std::forward<Fn>( f ) ); }
 
 // Gear Rating Conversions ==================================================
 
@@ -2836,6 +3111,7 @@ struct item_t
   bool init_special_effects();
 
   static bool download_item( item_t& );
+  static void prefetch_items( const std::vector<item_t>& items );
 
   static std::vector<stat_pair_t> str_to_stat_pair( const std::string& stat_str );
   static std::string stat_pairs_to_str( const std::vector<stat_pair_t>& stat_pairs );
@@ -3450,7 +3726,14 @@ struct player_collected_data_t
 
   // Metric used to end simulations early
   extended_sample_data_t target_metric;
-  mutex_t target_metric_mutex;
+  // Running moments of the target metric collected by this thread, used for convergence checks
+  streaming_sample_data_t target_metric_moments;
+  // Target metric moments published by the child threads, only allocated for the main thread's
+  // actors
+  std::unique_ptr<published_sample_data_t[]> thread_target_metric;
+  // Combat length factors of the iterations paired with the target metric (dps, tmi or hps by
+  // role), to tell how much of the metric variance comes from varying the combat length
+  streaming_covariance_data_t combat_length_metric;
 
   std::vector<simple_sample_data_t> resource_lost, resource_gained;
   struct resource_timeline_t
@@ -3511,6 +3794,9 @@ struct player_collected_data_t
   // used.
   int total_iterations;
 
+  // Rng stream of each collected iteration with paired_sampling, in the order of the samples
+  std::vector<uint64_t> iteration_streams;
+
   struct action_sequence_data_t
   {
     const action_t* action;
@@ -3753,12 +4039,13 @@ struct scaling_metric_data_t {
   std::string name;
   double value, stddev;
   scale_metric_e metric;
+  const extended_sample_data_t* samples; // per-iteration samples of the metric, if any
   scaling_metric_data_t( scale_metric_e m, const std::string& n, double v, double dev ) :
-    name( n ), value( v ), stddev( dev ), metric( m ) {}
+    name( n ), value( v ), stddev( dev ), metric( m ), samples( nullptr ) {}
   scaling_metric_data_t( scale_metric_e m, const extended_sample_data_t& sd ) :
-    name( sd.name_str ), value( sd.mean() ), stddev( sd.mean_std_dev ), metric( m ) {}
+    name( sd.name_str ), value( sd.mean() ), stddev( sd.mean_std_dev ), metric( m ), samples( &sd ) {}
   scaling_metric_data_t( scale_metric_e m, const sc_timeline_t& tl, const std::string& name ) :
-    name( name ), value( tl.mean() ), stddev( tl.mean_stddev() ), metric( m ) {}
+    name( name ), value( tl.mean() ), stddev( tl.mean_stddev() ), metric( m ), samples( nullptr ) {}
 };
 
 struct player_scaling_t
@@ -3854,6 +4141,7 @@ struct player_t : public actor_t
 
   // Option Parsing
   std::vector<std::unique_ptr<option_t>> options;
+  opts::index_t options_index;
 
   // Stat Timelines to Display
   std::vector<stat_e> stat_timelines;
@@ -4673,9 +4961,13 @@ struct player_t : public actor_t
 
   virtual void activate_action_list( action_priority_list_t* a, bool off_gcd = false );
 
+  // Actors are analyzed in parallel, pets on the same thread as (and after) their owner. Analysis
+  // must only touch the actor itself and its pets, not other actors or state shared through the sim.
   virtual void analyze( sim_t& );
 
+  const player_t* scaling_player() const;
   scaling_metric_data_t scaling_for_metric( scale_metric_e metric ) const;
+  double scaling_paired_std_dev( const player_t& ref, scale_metric_e metric ) const;
 
   void change_position( position_e );
   position_e position() const
@@ -5181,6 +5473,8 @@ public:
   timespan_t last_execute;
   extended_sample_data_t actual_amount, total_amount, portion_aps, portion_apse;
   std::vector<stats_t*> children;
+  // Action list condition (if=) evaluations of the actions using these stats, over the whole run
+  uint64_t expression_evaluations;
 
   struct stats_results_t
   {
@@ -7161,7 +7455,7 @@ struct travel_event_t : public event_t
 namespace item_database
 {
 bool     download_item(      item_t& item );
-bool     initialize_item_sources( item_t& item, std::vector<std::string>& source_list );
+bool     initialize_item_sources( const item_t& item, std::vector<std::string>& source_list );
 
 int      random_suffix_type( item_t& item );
 int      random_suffix_type( const item_data_t* );
@@ -7796,6 +8090,55 @@ namespace consumable
 action_t* create_action( player_t*, const std::string& name, const std::string& options );
 }
 
+// HTTP Download  ===========================================================
+
+namespace http
+{
+struct proxy_t
+{
+  std::string type;
+  std::string host;
+  int port;
+};
+
+// Url to download, and the url identifying it in the cache (e.g., without an api key)
+struct request_t
+{
+  std::string url;
+  std::string cleanurl;
+
+  request_t( const std::string& u, const std::string& c ) : url( u ), cleanurl( c )
+  { }
+};
+
+// Process-wide counters of http::get calls. Shared requests waited for a concurrent download of
+// the same url instead of downloading it again.
+struct statistics_t
+{
+  unsigned requests, hits, downloads, shared, failures;
+  uint64_t bytes;
+  double download_time;
+
+  statistics_t() : requests( 0 ), hits( 0 ), downloads( 0 ), shared( 0 ), failures( 0 ),
+    bytes( 0 ), download_time( 0 )
+  { }
+};
+
+void set_proxy( const std::string& type, const std::string& host, const unsigned port );
+
+void cache_load( const std::string& file_name );
+void cache_save( const std::string& file_name );
+bool clear_cache( sim_t*, const std::string& name, const std::string& value );
+
+bool get( std::string& result, const std::string& url, const std::string& cleanurl, cache::behavior_e b,
+          const std::string& confirmation = std::string() );
+
+// Download the requests into the cache, at most max_concurrency at a time
+void prefetch( const std::vector<request_t>& requests, cache::behavior_e b, unsigned max_concurrency );
+
+statistics_t statistics();
+}
+
 // Wowhead  =================================================================
 
 namespace wowhead
@@ -7820,6 +8163,9 @@ bool download_item_data( item_t&            item,
                          cache::behavior_e  caching,
                          wowhead_e          source );
 
+// Request of the xml data of an item, for prefetching
+http::request_t item_request( unsigned id, wowhead_e source );
+
 std::string domain_str( wowhead_e domain );
 }
 
@@ -7851,26 +8197,9 @@ player_t* from_local_json( sim_t*,
                          );
 
 bool download_item( item_t&, cache::behavior_e b = cache::items() );
-}
 
-// HTTP Download  ===========================================================
-
-namespace http
-{
-struct proxy_t
-{
-  std::string type;
-  std::string host;
-  int port;
-};
-void set_proxy( const std::string& type, const std::string& host, const unsigned port );
-
-void cache_load( const std::string& file_name );
-void cache_save( const std::string& file_name );
-bool clear_cache( sim_t*, const std::string& name, const std::string& value );
-
-bool get( std::string& result, const std::string& url, const std::string& cleanurl, cache::behavior_e b,
-          const std::string& confirmation = std::string() );
+// Request of the json data of an item, for prefetching
+http::request_t item_request( const std::string& region, unsigned id, const std::string& apikey );
 }
 
 // XML ======================================================================
@@ -4,10 +4,14 @@
 // ==========================================================================
 
 #include "concurrency.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <iostream>
 #include <thread>
 #include <mutex>
 #include <chrono>
+#include <vector>
 
 #if defined( SC_WINDOWS )
 #define NOMINMAX
@@ -138,6 +142,11 @@ unsigned sc_thread_t::cpu_thread_count()
 
 #if defined(SC_WINDOWS)
 #include <windows.h>
+// Resolve GetProcessMemoryInfo from kernel32, so that psapi.lib does not need to be linked
+#ifndef PSAPI_VERSION
+#define PSAPI_VERSION 2
+#endif
+#include <psapi.h>
 
 DWORD translate_priority( computer_process::priority_e p )
 {
@@ -164,9 +173,25 @@ void computer_process::set_priority( priority_e p )
  }
 }
 
+size_t computer_process::memory_usage()
+{
+  PROCESS_MEMORY_COUNTERS counters;
+  if ( ! GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )
+  {
+    return 0;
+  }
+
+  return counters.WorkingSetSize;
+}
+
 #elif defined(SC_OSX) || defined(__unix__)
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <unistd.h>
+#include <cstdio>
+#if defined(SC_OSX)
+#include <mach/mach.h>
+#endif
 
 int translate_priority( computer_process::priority_e p )
 {
@@ -192,11 +217,48 @@ void computer_process::set_priority( priority_e p )
     perror("Could not set process priority.");
   }
 }
+
+size_t computer_process::memory_usage()
+{
+#if defined(SC_OSX)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if ( task_info( mach_task_self(), MACH_TASK_BASIC_INFO,
+                  reinterpret_cast<task_info_t>( &info ), &count ) != KERN_SUCCESS )
+  {
+    return 0;
+  }
+
+  return static_cast<size_t>( info.resident_size );
+#else
+  // Second field of statm is the resident set size in pages
+  FILE* statm = fopen( "/proc/self/statm", "r" );
+  if ( ! statm )
+  {
+    return 0;
+  }
+
+  unsigned long size = 0, resident = 0;
+  auto fields = fscanf( statm, "%lu %lu", &size, &resident );
+  fclose( statm );
+  if ( fields != 2 )
+  {
+    return 0;
+  }
+
+  return static_cast<size_t>( resident ) * static_cast<size_t>( sysconf( _SC_PAGESIZE ) );
+#endif
+}
 #else
 void computer_process::set_priority( priority_e )
 {
   // do nothing
 }
+
+size_t computer_process::memory_usage()
+{
+  return 0;
+}
 #endif
 
 namespace thread
@@ -211,4 +273,54 @@ void set_main_thread_priority()
 #else
 #endif
 }
+
+void parallel_for( size_t n, unsigned max_threads, const std::function<void( size_t )>& f )
+{
+  if ( n == 0 )
+    return;
+
+  std::atomic<size_t> index( 0 );
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto run = [ n, &f, &index, &error, &error_mutex ]() {
+    for ( size_t i = index++; i < n; i = index++ )
+    {
+      try
+      {
+        f( i );
+      }
+      catch ( ... )
+      {
+        std::lock_guard<std::mutex> lock( error_mutex );
+        if ( ! error )
+        {
+          error = std::current_exception();
+        }
+        // Stop handing out work
+        index = n;
+      }
+    }
+  };
+
+  size_t n_threads = std::min( static_cast<size_t>( std::max( max_threads, 1U ) ), n );
+
+  std::vector<std::thread> threads;
+  for ( size_t i = 1; i < n_threads; ++i )
+  {
+    threads.push_back( std::thread( run ) );
+  }
+
+  run();
+
+  for ( auto& t : threads )
+  {
+    t.join();
+  }
+
+  if ( error )
+  {
+    std::rethrow_exception( error );
+  }
+}
 }
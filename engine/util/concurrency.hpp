@@ -13,6 +13,7 @@
 
 #include "config.hpp"
 #include "generic.hpp"
+#include <functional>
 #include <memory>
 #include <thread>
 
@@ -70,10 +71,18 @@ enum priority_e {
 };
 void set_priority( priority_e);
 
+// Current resident set size of the process in bytes, 0 if not available on the platform
+size_t memory_usage();
+
 } // computer_process
 
 namespace thread
 {
   // Windows (10) needs to promote main thread to higher priority
   void set_main_thread_priority();
+
+  // Call f( i ) for every i in [0, n) on up to max_threads threads, the calling thread included.
+  // Indices are claimed in ascending order. The first exception thrown by f is rethrown on the
+  // calling thread, once all threads have finished.
+  void parallel_for( size_t n, unsigned max_threads, const std::function<void( size_t )>& f );
 }
@@ -7,12 +7,19 @@
 #include "str.hpp"
 #include "utf8.h"
 #include <cassert>
+#include <cerrno>
 #include <cstring>
 #include <cstdarg>
 
 #ifdef SC_WINDOWS
 #include <windows.h>
 #include <shellapi.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 namespace io { // ===========================================================
@@ -268,4 +275,163 @@ std::string read_file_content( FILE* file )
   return buffer;
 }
 
+// mapped_file_t ============================================================
+
+#ifdef SC_WINDOWS
+mapped_file_t::mapped_file_t() :
+  m_data( nullptr ), m_size( 0 ), m_file( INVALID_HANDLE_VALUE ), m_mapping( nullptr )
+{ }
+
+bool mapped_file_t::open( const std::string& filename )
+{
+  close();
+
+  // Share writes and deletion, so the file can be appended to and replaced while mapped
+  m_file = CreateFileW( widen( filename ).c_str(), GENERIC_READ,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+  if ( m_file == INVALID_HANDLE_VALUE )
+    return false;
+
+  LARGE_INTEGER size;
+  if ( ! GetFileSizeEx( m_file, &size ) || size.QuadPart == 0 )
+  {
+    close();
+    return false;
+  }
+
+  m_mapping = CreateFileMappingW( m_file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+  if ( ! m_mapping )
+  {
+    close();
+    return false;
+  }
+
+  m_data = static_cast<const char*>( MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 ) );
+  if ( ! m_data )
+  {
+    close();
+    return false;
+  }
+
+  m_size = static_cast<size_t>( size.QuadPart );
+  return true;
+}
+
+void mapped_file_t::close()
+{
+  if ( m_data )
+    UnmapViewOfFile( m_data );
+  if ( m_mapping )
+    CloseHandle( m_mapping );
+  if ( m_file != INVALID_HANDLE_VALUE )
+    CloseHandle( m_file );
+
+  m_data = nullptr;
+  m_size = 0;
+  m_mapping = nullptr;
+  m_file = INVALID_HANDLE_VALUE;
+}
+
+// file_lock_t ==============================================================
+
+file_lock_t::file_lock_t( const std::string& filename )
+{
+  m_file = CreateFileW( widen( filename ).c_str(), GENERIC_READ | GENERIC_WRITE,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
+  if ( m_file == INVALID_HANDLE_VALUE )
+    return;
+
+  OVERLAPPED overlapped = OVERLAPPED();
+  if ( ! LockFileEx( m_file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped ) )
+  {
+    CloseHandle( m_file );
+    m_file = INVALID_HANDLE_VALUE;
+  }
+}
+
+// Closing the handle releases the lock
+file_lock_t::~file_lock_t()
+{
+  if ( m_file != INVALID_HANDLE_VALUE )
+    CloseHandle( m_file );
+}
+
+bool file_lock_t::is_locked() const
+{ return m_file != INVALID_HANDLE_VALUE; }
+
+#else
+
+mapped_file_t::mapped_file_t() :
+  m_data( nullptr ), m_size( 0 )
+{ }
+
+bool mapped_file_t::open( const std::string& filename )
+{
+  close();
+
+  int fd = ::open( filename.c_str(), O_RDONLY );
+  if ( fd < 0 )
+    return false;
+
+  struct stat st;
+  if ( fstat( fd, &st ) != 0 || st.st_size == 0 )
+  {
+    ::close( fd );
+    return false;
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  void* data = mmap( nullptr, static_cast<size_t>( st.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+  ::close( fd );
+  if ( data == MAP_FAILED )
+    return false;
+
+  m_data = static_cast<const char*>( data );
+  m_size = static_cast<size_t>( st.st_size );
+  return true;
+}
+
+void mapped_file_t::close()
+{
+  if ( m_data )
+    munmap( const_cast<char*>( m_data ), m_size );
+
+  m_data = nullptr;
+  m_size = 0;
+}
+
+// file_lock_t ==============================================================
+
+file_lock_t::file_lock_t( const std::string& filename ) :
+  m_fd( ::open( filename.c_str(), O_RDWR | O_CREAT, 0644 ) )
+{
+  if ( m_fd < 0 )
+    return;
+
+  int ret;
+  do
+  {
+    ret = flock( m_fd, LOCK_EX );
+  } while ( ret != 0 && errno == EINTR );
+
+  if ( ret != 0 )
+  {
+    ::close( m_fd );
+    m_fd = -1;
+  }
+}
+
+// Closing the descriptor releases the lock
+file_lock_t::~file_lock_t()
+{
+  if ( m_fd >= 0 )
+    ::close( m_fd );
+}
+
+bool file_lock_t::is_locked() const
+{ return m_fd >= 0; }
+#endif
+
 } // namespace io ===========================================================
@@ -56,6 +56,56 @@ public:
   void close() { file.reset(); }
 };
 
+// Read-only memory mapping of a file. Pages of the file are read in when they are accessed.
+class mapped_file_t
+{
+  const char* m_data;
+  size_t      m_size;
+#ifdef SC_WINDOWS
+  void*       m_file;
+  void*       m_mapping;
+#endif
+
+public:
+  mapped_file_t();
+  ~mapped_file_t()
+  { close(); }
+
+  mapped_file_t( const mapped_file_t& ) = delete;
+  mapped_file_t& operator=( const mapped_file_t& ) = delete;
+
+  // Map the file, fails if it does not exist or is empty
+  bool open( const std::string& filename );
+  void close();
+
+  const char* data() const
+  { return m_data; }
+
+  size_t size() const
+  { return m_size; }
+};
+
+// Exclusive advisory lock of a lock file, created if it does not exist. Blocks until the lock is
+// acquired, and releases it when destroyed. Only excludes other users of the same lock file.
+class file_lock_t
+{
+#ifdef SC_WINDOWS
+  void* m_file;
+#else
+  int   m_fd;
+#endif
+
+public:
+  explicit file_lock_t( const std::string& filename );
+  ~file_lock_t();
+
+  file_lock_t( const file_lock_t& ) = delete;
+  file_lock_t& operator=( const file_lock_t& ) = delete;
+
+  // False if the lock file could not be opened or locked
+  bool is_locked() const;
+};
+
 class ofstream : public std::ofstream
 {
 public:
@@ -7,6 +7,7 @@
 #include <ctime>
 #include <stdint.h>
 #include <string>
+#include <algorithm>
 #include "rng.hpp"
 
 // Pseudo-Random Number Generation ==========================================
@@ -54,6 +55,22 @@ double convert_to_double_0_1( uint64_t ui64 )
   return u.d - 1.0;
 }
 
+/**
+ * Engine base class, filling buffers through a non-virtual call of the
+ * engine's own draw, which the compiler can inline into the loop.
+ */
+template <typename Engine>
+struct rng_engine_t : public rng_t
+{
+  virtual void real_n( double* buffer, size_t n ) override
+  {
+    Engine* engine = static_cast<Engine*>( this );
+    for ( size_t i = 0; i < n; ++i )
+    {
+      buffer[ i ] = engine -> Engine::engine_real();
+    }
+  }
+};
 
 /**
  * @brief STL Mersenne twister MT19937
@@ -63,7 +80,7 @@ double convert_to_double_0_1( uint64_t ui64 )
  * maintenance cost.
  * Unfortunately, it is slower than the dsfmt implementation.
  */
-struct rng_mt_cxx11_t : public rng_t
+struct rng_mt_cxx11_t : public rng_engine_t<rng_mt_cxx11_t>
 {
   std::mt19937 engine; // Mersenne twister MT19937
   std::uniform_real_distribution<double> dist;
@@ -72,18 +89,18 @@ struct rng_mt_cxx11_t : public rng_t
 
   virtual const char* name() const override { return "mt_cxx11"; }
 
-  virtual void seed( uint64_t start ) override
+  virtual void engine_seed( uint64_t start ) override
   { 
     engine.seed( (unsigned) start ); 
   }
 
-  virtual double real() override
+  virtual double engine_real() override
   { 
     return dist( engine );
   }
 };
 
-struct rng_mt_cxx11_64_t : public rng_t
+struct rng_mt_cxx11_64_t : public rng_engine_t<rng_mt_cxx11_64_t>
 {
   std::mt19937_64 engine; // Mersenne twister MT19937
 
@@ -91,12 +108,12 @@ struct rng_mt_cxx11_64_t : public rng_t
 
   virtual const char* name() const override { return "mt_cxx11_64"; }
 
-  virtual void seed( uint64_t start ) override
+  virtual void engine_seed( uint64_t start ) override
   {
     engine.seed( start );
   }
 
-  virtual double real() override
+  virtual double engine_real() override
   {
     return convert_to_double_0_1(engine());
   }
@@ -108,7 +125,7 @@ struct rng_mt_cxx11_64_t : public rng_t
  *
  * All credit goes to https://code.google.com/p/smhasher
  */
-struct rng_murmurhash_t : public rng_t
+struct rng_murmurhash_t : public rng_engine_t<rng_murmurhash_t>
 {
   uint64_t x; /* The state must be seeded with a nonzero value. */
 
@@ -123,13 +140,13 @@ struct rng_murmurhash_t : public rng_t
 
   virtual const char* name() const override { return "murmurhash3"; }
 
-  virtual void seed( uint64_t start ) override
+  virtual void engine_seed( uint64_t start ) override
   { 
     assert( start != 0 );
     x = start;
   }
 
-  virtual double real() override
+  virtual double engine_real() override
   { 
     return convert_to_double_0_1( next() );
   }
@@ -142,7 +159,7 @@ struct rng_murmurhash_t : public rng_t
  * All credit goes to Sebastiano Vigna (vigna@acm.org) @2014
  * http://xorshift.di.unimi.it/
  */
-struct rng_xorshift64_t : public rng_t
+struct rng_xorshift64_t : public rng_engine_t<rng_xorshift64_t>
 {
   uint64_t x; /* The state must be seeded with a nonzero value. */
 
@@ -156,13 +173,13 @@ struct rng_xorshift64_t : public rng_t
 
   virtual const char* name() const override { return "xorshift64"; }
 
-  virtual void seed( uint64_t start ) override
+  virtual void engine_seed( uint64_t start ) override
   { 
     assert( start != 0 );
     x = start;
   }
 
-  virtual double real() override
+  virtual double engine_real() override
   { 
     return convert_to_double_0_1( next() );
   }
@@ -175,7 +192,7 @@ struct rng_xorshift64_t : public rng_t
  * All credit goes to Sebastiano Vigna (vigna@acm.org) @2014
  * http://xorshift.di.unimi.it/
  */
-struct rng_xorshift128_t : public rng_t
+struct rng_xorshift128_t : public rng_engine_t<rng_xorshift128_t>
 {
   uint64_t s[ 2 ];
 
@@ -190,7 +207,7 @@ struct rng_xorshift128_t : public rng_t
 
   virtual const char* name() const override { return "xorshift128"; }
 
-  virtual void seed( uint64_t start ) override
+  virtual void engine_seed( uint64_t start ) override
   { 
     rng_murmurhash_t mmh;
     mmh.seed( start );
@@ -199,7 +216,7 @@ struct rng_xorshift128_t : public rng_t
     s[ 1 ] = mmh.next();
   }
 
-  virtual double real() override
+  virtual double engine_real() override
   { 
     return convert_to_double_0_1( next() );
   }
@@ -212,7 +229,7 @@ struct rng_xorshift128_t : public rng_t
  * All credit goes to Sebastiano Vigna (vigna@acm.org) @2014
  * http://xorshift.di.unimi.it/
  */
-struct rng_xorshift1024_t : public rng_t
+struct rng_xorshift1024_t : public rng_engine_t<rng_xorshift1024_t>
 {
   uint64_t s[ 16 ]; 
   int p;
@@ -229,7 +246,7 @@ struct rng_xorshift1024_t : public rng_t
 
   virtual const char* name() const override { return "xorshift1024"; }
 
-  virtual void seed( uint64_t start ) override
+  virtual void engine_seed( uint64_t start ) override
   { 
     rng_xorshift64_t xs64;
     xs64.seed( start );
@@ -237,7 +254,7 @@ struct rng_xorshift1024_t : public rng_t
     p = 0;
   }
 
-  virtual double real() override
+  virtual double engine_real() override
   { 
     return convert_to_double_0_1( next() );
   }
@@ -503,16 +520,43 @@ struct rng_sfmt_t : public rng_t
 #endif
   }
   
-  virtual void seed( uint64_t start ) override
+  virtual void engine_seed( uint64_t start ) override
   { 
     dsfmt_chk_init_gen_rand( &dsfmt_global_data, (uint32_t) start ); 
   }
 
-  virtual double real() override
+  virtual double engine_real() override
   { 
     return dsfmt_genrand_close_open( &dsfmt_global_data ) - 1.0; 
   }
 
+  /**
+   * Copy whole runs of the generated state array, which dsfmt produces a block
+   * at a time anyway.
+   */
+  virtual void real_n( double* buffer, size_t n ) override
+  {
+    const double* psfmt64 = &dsfmt_global_data.status[0].d[0];
+    while ( n > 0 )
+    {
+      if ( dsfmt_global_data.idx >= DSFMT_N64 )
+      {
+        dsfmt_gen_rand_all( &dsfmt_global_data );
+        dsfmt_global_data.idx = 0;
+      }
+
+      size_t count = std::min( n, static_cast<size_t>( DSFMT_N64 - dsfmt_global_data.idx ) );
+      for ( size_t i = 0; i < count; ++i )
+      {
+        buffer[ i ] = psfmt64[ dsfmt_global_data.idx + i ] - 1.0;
+      }
+
+      dsfmt_global_data.idx += static_cast<int>( count );
+      buffer += count;
+      n -= count;
+    }
+  }
+
   /**
    * Special implementation because dsfmt only allows 32bit seed
    */
@@ -536,7 +580,7 @@ struct rng_sfmt_t : public rng_t
  * Hiroshima University and The University of Tokyo.
  * All rights reserved.
  */
-struct rng_tinymt_t : public rng_t
+struct rng_tinymt_t : public rng_engine_t<rng_tinymt_t>
 {
   static const uint64_t TINYMT64_SH0  = 12;
   static const uint64_t TINYMT64_SH1  = 11;
@@ -603,7 +647,7 @@ struct rng_tinymt_t : public rng_t
 
   virtual const char* name() const override { return "tinymt"; }
 
-  virtual void seed( uint64_t start ) override
+  virtual void engine_seed( uint64_t start ) override
   {
     // mat1, mat2, and tmat are inputs to the engine
     // I am uncertain how to set them so we'll just grind the seed through MurmurHash.
@@ -616,34 +660,119 @@ struct rng_tinymt_t : public rng_t
     init( start );
   }
 
-  virtual double real() override
+  virtual double engine_real() override
   {
     next_state();
     return temper_conv_open() - 1.0;
   }
 };
 
+/**
+ * @brief Philox4x32-10 counter-based Random Number Generator
+ *
+ * Each block of output is a keyed bijection of a 128 bit counter, so any
+ * position of any stream can be generated directly. The seed is the key, the
+ * upper half of the counter selects the stream and the lower half is the
+ * position within the stream.
+ *
+ * Salmon, Moraes, Dror, Shaw: Parallel Random Numbers: As Easy as 1, 2, 3
+ * http://www.thesalmons.org/john/random123/
+ */
+struct rng_philox_t : public rng_t
+{
+  uint32_t key[ 2 ];
+  uint32_t counter[ 4 ];
+  uint64_t block[ 2 ];
+  unsigned block_pos;
+
+  rng_philox_t() : key(), counter(), block(), block_pos( 2 ) {}
+
+  static void round( uint32_t* ctr, const uint32_t* k )
+  {
+    uint64_t p0 = uint64_t( 0xD2511F53 ) * ctr[ 0 ];
+    uint64_t p1 = uint64_t( 0xCD9E8D57 ) * ctr[ 2 ];
+    uint32_t hi0 = static_cast<uint32_t>( p0 >> 32 ), lo0 = static_cast<uint32_t>( p0 );
+    uint32_t hi1 = static_cast<uint32_t>( p1 >> 32 ), lo1 = static_cast<uint32_t>( p1 );
+    ctr[ 0 ] = hi1 ^ ctr[ 1 ] ^ k[ 0 ];
+    ctr[ 1 ] = lo1;
+    ctr[ 2 ] = hi0 ^ ctr[ 3 ] ^ k[ 1 ];
+    ctr[ 3 ] = lo0;
+  }
+
+  // Encrypt the current counter into block, and advance the counter
+  void next_block()
+  {
+    uint32_t ctr[ 4 ] = { counter[ 0 ], counter[ 1 ], counter[ 2 ], counter[ 3 ] };
+    uint32_t k[ 2 ] = { key[ 0 ], key[ 1 ] };
+    for ( int r = 0; r < 10; ++r )
+    {
+      if ( r > 0 )
+      {
+        k[ 0 ] += 0x9E3779B9;
+        k[ 1 ] += 0xBB67AE85;
+      }
+      round( ctr, k );
+    }
+
+    block[ 0 ] = ( uint64_t( ctr[ 1 ] ) << 32 ) | ctr[ 0 ];
+    block[ 1 ] = ( uint64_t( ctr[ 3 ] ) << 32 ) | ctr[ 2 ];
+    block_pos = 0;
+
+    if ( ++counter[ 0 ] == 0 )
+      ++counter[ 1 ];
+  }
+
+  virtual const char* name() const override { return "philox4x32"; }
+
+  virtual void engine_seed( uint64_t start ) override
+  {
+    key[ 0 ] = static_cast<uint32_t>( start );
+    key[ 1 ] = static_cast<uint32_t>( start >> 32 );
+    stream( 0 );
+  }
+
+  virtual void stream( uint64_t id ) override
+  {
+    counter[ 0 ] = counter[ 1 ] = 0;
+    counter[ 2 ] = static_cast<uint32_t>( id );
+    counter[ 3 ] = static_cast<uint32_t>( id >> 32 );
+    block_pos = 2;
+    reset();
+  }
+
+  virtual double engine_real() override
+  {
+    if ( block_pos == 2 )
+      next_block();
+
+    return convert_to_double_0_1( block[ block_pos++ ] );
+  }
+
+  virtual void real_n( double* buffer, size_t n ) override
+  {
+    size_t i = 0;
+    while ( i < n && block_pos < 2 )
+      buffer[ i++ ] = convert_to_double_0_1( block[ block_pos++ ] );
+
+    for ( ; i + 2 <= n; i += 2 )
+    {
+      next_block();
+      buffer[ i ] = convert_to_double_0_1( block[ 0 ] );
+      buffer[ i + 1 ] = convert_to_double_0_1( block[ 1 ] );
+    }
+    block_pos = 2;
+
+    if ( i < n )
+      buffer[ i ] = engine_real();
+  }
+};
+
 } // unnamed
 
 // ==========================================================================
 // Probability Distributions
 // ==========================================================================
 
-/// Bernoulli Distribution
-bool rng_t::roll( double chance )
-{
-  if ( chance <= 0 ) return false;
-  if ( chance >= 1 ) return true;
-  return real() < chance;
-}
-
-/// Uniform distribution in the range [min max]
-double rng_t::range( double min, double max )
-{
-  assert( min <= max );
-  return min + real() * ( max - min );
-}
-
 /**
  * @brief Gaussian Distribution
  *
@@ -748,15 +877,50 @@ uint64_t rng_t::reseed()
   return w.s;
 }
 
+/// Seed the engine and discard numbers prefetched from the previous state
+void rng_t::seed( uint64_t start )
+{
+  engine_seed( start );
+  reset();
+}
+
+/// Refill the prefetch buffer from the engine
+void rng_t::prefetch()
+{
+  real_n( prefetch_buffer, PREFETCH_SIZE );
+  if ( antithetic_draws )
+  {
+    for ( auto& x : prefetch_buffer )
+      x = 1.0 - x;
+  }
+  prefetch_pos = 0;
+}
+
+/// Fill buffer with n uniformly distributed numbers in range [0,1]
+void rng_t::real_n( double* buffer, size_t n )
+{
+  for ( size_t i = 0; i < n; ++i )
+  {
+    buffer[ i ] = engine_real();
+  }
+}
+
+/// Streams are only supported by counter based engines
+void rng_t::stream( uint64_t )
+{
+  assert( false && "rng engine does not support streams" );
+}
+
 /// reset any state
 void rng_t::reset()
 {
   gauss_pair_value = 0;
   gauss_pair_use = false;
+  discard_prefetch();
 }
 
 rng_t::rng_t() :
-    gauss_pair_value( 0.0 ), gauss_pair_use( false )
+    prefetch_pos( PREFETCH_SIZE ), antithetic_draws( false ), gauss_pair_value( 0.0 ), gauss_pair_use( false )
 {
 }
 
@@ -774,10 +938,16 @@ engine_type parse_type( const std::string& n )
   if( n == "xorshift64"   ) return engine_type::XORSHIFT64;
   if( n == "xorshift128"  ) return engine_type::XORSHIFT128;
   if( n == "xorshift1024" ) return engine_type::XORSHIFT1024;
+  if( n == "philox"       ) return engine_type::PHILOX;
 
   return engine_type::DEFAULT;
 }
 
+bool counter_based( engine_type t )
+{
+  return t == engine_type::PHILOX;
+}
+
 /**
  * Factory method to create a rng object with given rng-engine type
  */
@@ -806,6 +976,9 @@ std::unique_ptr<rng_t> create( engine_type t )
   case engine_type::XORSHIFT1024:
     return std::unique_ptr<rng_t>(new rng_xorshift1024_t());
 
+  case engine_type::PHILOX:
+    return std::unique_ptr<rng_t>(new rng_philox_t());
+
   case engine_type::DEFAULT:
   default:
     break;
@@ -1023,6 +1196,34 @@ static void test_one( rng_t* rng, uint64_t n )
                ", numbers/sec = " << static_cast<uint64_t>( n * 1000.0 / elapsed_cpu ) << "\n\n";
 }
 
+// Bernoulli draws per second straight from the engine, and through the prefetch buffer
+static void test_buffering( rng_t* engine, uint64_t n )
+{
+  // Hide the dynamic type from the optimizer, as it is hidden from the simulation code calling
+  // through sim_t::rng()
+  rng_t* volatile opaque = engine;
+  rng_t* rng = opaque;
+  rng -> reset();
+
+  int64_t start_time = milliseconds();
+  uint64_t count = 0;
+  for ( uint64_t i = 0; i < n; ++i )
+    count += rng -> engine_real() < 0.3;
+  int64_t elapsed_unbuffered = std::max( int64_t( 1 ), milliseconds() - start_time );
+
+  start_time = milliseconds();
+  uint64_t count_buffered = 0;
+  for ( uint64_t i = 0; i < n; ++i )
+    count_buffered += rng -> roll( 0.3 );
+  int64_t elapsed_buffered = std::max( int64_t( 1 ), milliseconds() - start_time );
+
+  std::cout << std::setw( 13 ) << rng -> name()
+            << ": unbuffered = " << std::setw( 11 ) << static_cast<uint64_t>( n * 1000.0 / elapsed_unbuffered )
+            << ", buffered = " << std::setw( 11 ) << static_cast<uint64_t>( n * 1000.0 / elapsed_buffered )
+            << " draws/sec, rate = " << std::setprecision( 6 ) << static_cast<double>( count ) / n
+            << " / " << static_cast<double>( count_buffered ) / n << "\n";
+}
+
 static void test_seed( rng_t* rng, uint64_t n )
 {
   int64_t start_time = milliseconds();
@@ -1073,6 +1274,7 @@ int main( int /*argc*/, char** /*argv*/ )
   rng_t* rng_tinymt = new rng_tinymt_t();
   rng_t* rng_xs128  = new rng_xorshift128_t();
   rng_t* rng_xs1024 = new rng_xorshift1024_t();
+  rng_t* rng_philox = new rng_philox_t();
 
   std::random_device rd;
   uint64_t seed  = uint64_t(rd()) | (uint64_t(rd()) << 32);
@@ -1086,6 +1288,7 @@ int main( int /*argc*/, char** /*argv*/ )
   rng_tinymt -> seed( seed );
   rng_xs128  -> seed( seed );
   rng_xs1024 -> seed( seed );
+  rng_philox -> seed( seed );
 
   uint64_t n = 100000000;
 
@@ -1096,6 +1299,18 @@ int main( int /*argc*/, char** /*argv*/ )
   test_one( rng_tinymt, n );
   test_one( rng_xs128,  n );
   test_one( rng_xs1024, n );
+  test_one( rng_philox, n );
+
+  std::cout << "Prefetch buffering:\n";
+  test_buffering( rng_mt_cxx11,   n );
+  test_buffering( rng_mt_cxx11_64,   n );
+  test_buffering( rng_murmurhash,   n );
+  test_buffering( rng_sfmt,   n );
+  test_buffering( rng_tinymt, n );
+  test_buffering( rng_xs128,  n );
+  test_buffering( rng_xs1024, n );
+  test_buffering( rng_philox, n );
+  std::cout << "\n";
 
   monte_carlo( rng_mt_cxx11,   n );
   monte_carlo( rng_murmurhash,   n );
@@ -1103,6 +1318,7 @@ int main( int /*argc*/, char** /*argv*/ )
   monte_carlo( rng_tinymt, n );
   monte_carlo( rng_xs128,  n );
   monte_carlo( rng_xs1024, n );
+  monte_carlo( rng_philox, n );
 
   test_seed( rng_mt_cxx11,   100000 );
   test_seed( rng_murmurhash,   100000 );
@@ -1110,6 +1326,7 @@ int main( int /*argc*/, char** /*argv*/ )
   test_seed( rng_tinymt, 100000 );
   test_seed( rng_xs128,  100000 );
   test_seed( rng_xs1024, 100000 );
+  test_seed( rng_philox, 100000 );
 
 
   std::cout << "random device: min=" << rd.min() << " max=" << rd.max() << "\n\n";
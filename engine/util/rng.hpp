@@ -20,7 +20,7 @@ namespace rng {
 
 /// rng engines
 enum class engine_type {
-  DEFAULT, MURMURHASH, SFMT, STD, TINYMT, XORSHIFT64, XORSHIFT128, XORSHIFT1024
+  DEFAULT, MURMURHASH, SFMT, STD, TINYMT, XORSHIFT64, XORSHIFT128, XORSHIFT1024, PHILOX
 };
 
 /**\ingroup SC_RNG
@@ -35,15 +35,41 @@ struct rng_t
   virtual ~rng_t() {}
   /// name of rng engine
   virtual const char* name() const = 0;
-  /// seed rng engine
-  virtual void seed( uint64_t start ) = 0;
-  /// uniform distribution in range [0,1]
-  virtual double real() = 0;
+  /// seed rng engine, discarding any prefetched numbers
+  void seed( uint64_t start );
+  /// uniform distribution in range [0,1], consumed from the prefetch buffer
+  double real()
+  {
+    if ( prefetch_pos == PREFETCH_SIZE )
+      prefetch();
+    return prefetch_buffer[ prefetch_pos++ ];
+  }
+  /// uniform distribution in range [0,1], drawn directly from the engine
+  virtual double engine_real() = 0;
+  /// fill buffer with n numbers of uniform distribution in range [0,1], drawn directly from the engine
+  virtual void real_n( double* buffer, size_t n );
   virtual uint64_t reseed();
   virtual void reset();
+  /// switch to the independent stream id of the current seed (counter based engines only, see
+  /// rng::counter_based)
+  virtual void stream( uint64_t id );
+  /// mirror uniform draws u to 1 - u, starting from the next draw from the engine
+  void antithetic( bool enabled )
+  { antithetic_draws = enabled; }
 
-  bool roll( double chance );
-  double range( double min, double max );
+  /// Bernoulli Distribution
+  bool roll( double chance )
+  {
+    if ( chance <= 0 ) return false;
+    if ( chance >= 1 ) return true;
+    return real() < chance;
+  }
+  /// Uniform distribution in the range [min max]
+  double range( double min, double max )
+  {
+    assert( min <= max );
+    return min + real() * ( max - min );
+  }
   double gauss( double mean, double stddev, bool truncate_low_end = false );
   double exponential( double nu );
   double exgauss( double gauss_mean, double gauss_stddev, double exp_nu );
@@ -52,15 +78,30 @@ struct rng_t
   timespan_t exgauss( timespan_t mean, timespan_t stddev, timespan_t nu );
 protected:
   rng_t();
+  /// seed the engine itself
+  virtual void engine_seed( uint64_t start ) = 0;
+  /// discard prefetched numbers, so the next draw comes from the current engine state
+  void discard_prefetch()
+  { prefetch_pos = PREFETCH_SIZE; }
 private:
+  // Uniform numbers are generated in blocks through real_n(), so the engine is
+  // called virtually once per block instead of once per draw.
+  static const unsigned PREFETCH_SIZE = 128;
+  double prefetch_buffer[ PREFETCH_SIZE ];
+  unsigned prefetch_pos;
+  bool antithetic_draws;
+
   // Allow re-use of unused ( but necessary ) random number of a previous call to gauss()  
   double gauss_pair_value; 
   bool   gauss_pair_use;
 
+  void prefetch();
 };
 
 std::unique_ptr<rng_t> create( engine_type = engine_type::DEFAULT );
 engine_type parse_type( const std::string& name );
+/// true if engines of the given type can jump to independent streams of their seed
+bool counter_based( engine_type );
 
 double stdnormal_cdf( double );
 double stdnormal_inv( double );
@@ -6,6 +6,8 @@
 #ifndef SAMPLE_DATA_HPP
 #define SAMPLE_DATA_HPP
 
+#include <atomic>
+#include <cmath>
 #include <limits>
 #include <numeric>
 #include <sstream>
@@ -331,6 +333,202 @@ public:
   }
 };
 
+/* Streaming sample data container. Tracks count, mean and the sum of squared
+ * deviations incrementally (Welford), so mean and variance are available in
+ * constant time at any point. Two containers can be merged with the parallel
+ * formula of Chan et al.
+ */
+class streaming_sample_data_t
+{
+public:
+  using value_t = double;
+
+private:
+  size_t _count = 0;
+  value_t _mean = 0.0;
+  value_t _m2   = 0.0;
+
+public:
+  streaming_sample_data_t() = default;
+
+  streaming_sample_data_t( size_t count, value_t mean, value_t m2 )
+    : _count( count ), _mean( mean ), _m2( m2 )
+  {
+  }
+
+  void add( value_t x )
+  {
+    ++_count;
+    value_t delta = x - _mean;
+    _mean += delta / _count;
+    _m2 += delta * ( x - _mean );
+  }
+
+  void merge( const streaming_sample_data_t& other )
+  {
+    if ( other._count == 0 )
+      return;
+
+    size_t count  = _count + other._count;
+    value_t delta = other._mean - _mean;
+    _mean += delta * other._count / count;
+    _m2 += other._m2 + delta * delta * _count * other._count / count;
+    _count = count;
+  }
+
+  size_t count() const
+  {
+    return _count;
+  }
+
+  value_t mean() const
+  {
+    return _mean;
+  }
+
+  value_t m2() const
+  {
+    return _m2;
+  }
+
+  // Variance of the samples, same definition as statistics::calculate_variance
+  value_t variance() const
+  {
+    return _count > 1 ? _m2 / _count : 0.0;
+  }
+
+  // Standard Deviation of the sample mean ( Central Limit Theorem )
+  value_t mean_std_dev() const
+  {
+    return _count > 1 ? std::sqrt( variance() / _count ) : 0.0;
+  }
+
+  void reset()
+  {
+    _count = 0;
+    _mean  = 0.0;
+    _m2    = 0.0;
+  }
+};
+
+/* Streaming container of paired samples (x, y). Tracks the means, and the sums
+ * of squared deviations and of the products of the deviations incrementally,
+ * so that the share of the variance of y explained by a linear dependency on x
+ * is available at any point. Merged like streaming_sample_data_t.
+ */
+class streaming_covariance_data_t
+{
+public:
+  using value_t = double;
+
+private:
+  size_t _count = 0;
+  value_t _mean_x = 0.0, _mean_y = 0.0;
+  value_t _m2_x = 0.0, _m2_y = 0.0, _c_xy = 0.0;
+
+public:
+  void add( value_t x, value_t y )
+  {
+    ++_count;
+    value_t delta_x = x - _mean_x;
+    value_t delta_y = y - _mean_y;
+    _mean_x += delta_x / _count;
+    _mean_y += delta_y / _count;
+    _m2_x += delta_x * ( x - _mean_x );
+    _m2_y += delta_y * ( y - _mean_y );
+    _c_xy += delta_x * ( y - _mean_y );
+  }
+
+  void merge( const streaming_covariance_data_t& other )
+  {
+    if ( other._count == 0 )
+      return;
+
+    size_t count    = _count + other._count;
+    value_t delta_x = other._mean_x - _mean_x;
+    value_t delta_y = other._mean_y - _mean_y;
+    value_t weight  = static_cast<value_t>( _count ) * other._count / count;
+    _mean_x += delta_x * other._count / count;
+    _mean_y += delta_y * other._count / count;
+    _m2_x += other._m2_x + delta_x * delta_x * weight;
+    _m2_y += other._m2_y + delta_y * delta_y * weight;
+    _c_xy += other._c_xy + delta_x * delta_y * weight;
+    _count = count;
+  }
+
+  size_t count() const
+  {
+    return _count;
+  }
+
+  value_t mean() const
+  {
+    return _mean_y;
+  }
+
+  // Variance of y, same definition as statistics::calculate_variance
+  value_t variance() const
+  {
+    return _count > 1 ? _m2_y / _count : 0.0;
+  }
+
+  // Share of the variance of y explained by a linear dependency on x (squared
+  // correlation coefficient)
+  value_t explained_variance() const
+  {
+    if ( _m2_x <= 0 || _m2_y <= 0 )
+      return 0.0;
+
+    return std::min( 1.0, _c_xy * _c_xy / ( _m2_x * _m2_y ) );
+  }
+
+  void reset()
+  {
+    _count  = 0;
+    _mean_x = _mean_y = 0.0;
+    _m2_x = _m2_y = _c_xy = 0.0;
+  }
+};
+
+/* Snapshot of a streaming_sample_data_t, written by a single thread and read by
+ * any other thread without locking. Readers retry while a write is in progress
+ * (sequence lock).
+ */
+class published_sample_data_t
+{
+  std::atomic<unsigned> _sequence;
+  std::atomic<size_t> _count;
+  std::atomic<double> _mean, _m2;
+
+public:
+  published_sample_data_t() : _sequence( 0 ), _count( 0 ), _mean( 0.0 ), _m2( 0.0 )
+  {
+  }
+
+  void publish( const streaming_sample_data_t& data )
+  {
+    _sequence.fetch_add( 1 );
+    _count = data.count();
+    _mean  = data.mean();
+    _m2    = data.m2();
+    _sequence.fetch_add( 1 );
+  }
+
+  streaming_sample_data_t read() const
+  {
+    while ( true )
+    {
+      unsigned sequence = _sequence;
+      if ( sequence & 1 )
+        continue;
+
+      streaming_sample_data_t data( _count, _mean, _m2 );
+      if ( _sequence == sequence )
+        return data;
+    }
+  }
+};
+
 /* Extensive sample_data container with two runtime dependent modes:
  * - simple: Only offers sum, count
  *  -!simple: saves data and offers variance, percentiles, distribution, etc.
@@ -1,12 +1,339 @@
+// ==========================================================================
+// Dedmonwakeen's Raid DPS/TPS Simulator.
+// Send questions to natehieter@gmail.com
+// ==========================================================================
+
 #include "timeline.hpp"
-#include <iostream>
+
+// Vectorized timeline kernels ==============================================
+
+#if defined(__SSE2__) || ( defined( SC_VS ) && ( defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) ) )
+#  define TIMELINE_USE_SSE2
+#  if defined( SC_VS ) || ( defined( SC_GCC ) && SC_GCC >= 40900 ) || ( defined( SC_CLANG ) && SC_CLANG >= 30800 )
+#    define TIMELINE_USE_AVX2
+#  endif
+#endif
+
+#if defined( TIMELINE_USE_AVX2 )
+#  include <immintrin.h>
+#  if defined( SC_VS )
+#    include <intrin.h>
+#    define TIMELINE_TARGET_AVX2
+#  else
+#    define TIMELINE_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+#  endif
+#elif defined( TIMELINE_USE_SSE2 )
+#  include <emmintrin.h>
+#endif
+
+namespace timeline_kernel {
+
+namespace {
+
+struct kernels_t
+{
+  isa_e isa;
+  void ( *add )( double*, const double*, size_t );
+  void ( *divide )( double*, const double*, size_t );
+  void ( *min_max )( const double*, size_t, double&, double& );
+};
+
+// Scalar kernels, also used for the tails of the vectorized ones
+
+void add_scalar( double* dst, const double* src, size_t n )
+{
+  for ( size_t i = 0; i < n; ++i )
+    dst[ i ] += src[ i ];
+}
+
+void divide_scalar( double* dst, const double* divisor, size_t n )
+{
+  for ( size_t i = 0; i < n; ++i )
+    dst[ i ] /= divisor[ i ];
+}
+
+// Same comparisons as std::min_element / std::max_element: a value only
+// replaces the current minimum (maximum) if it compares less (greater), so a
+// NaN is never picked up, and a NaN first value is kept. The vectorized
+// versions use the same comparisons per lane.
+void min_max_scalar( const double* data, size_t n, double& min, double& max )
+{
+  for ( size_t i = 0; i < n; ++i )
+  {
+    if ( data[ i ] < min ) min = data[ i ];
+    if ( max < data[ i ] ) max = data[ i ];
+  }
+}
+
+// Reduce the per-lane results of a vectorized min/max, in lane order
+void min_max_lanes( const double* lanes_min, const double* lanes_max, size_t n, double& min, double& max )
+{
+  for ( size_t i = 0; i < n; ++i )
+  {
+    if ( lanes_min[ i ] < min ) min = lanes_min[ i ];
+    if ( max < lanes_max[ i ] ) max = lanes_max[ i ];
+  }
+}
+
+#if defined( TIMELINE_USE_SSE2 )
+void add_sse2( double* dst, const double* src, size_t n )
+{
+  size_t i = 0;
+  for ( ; i + 2 <= n; i += 2 )
+    _mm_storeu_pd( dst + i, _mm_add_pd( _mm_loadu_pd( dst + i ), _mm_loadu_pd( src + i ) ) );
+  add_scalar( dst + i, src + i, n - i );
+}
+
+void divide_sse2( double* dst, const double* divisor, size_t n )
+{
+  size_t i = 0;
+  for ( ; i + 2 <= n; i += 2 )
+    _mm_storeu_pd( dst + i, _mm_div_pd( _mm_loadu_pd( dst + i ), _mm_loadu_pd( divisor + i ) ) );
+  divide_scalar( dst + i, divisor + i, n - i );
+}
+
+void min_max_sse2( const double* data, size_t n, double& min, double& max )
+{
+  size_t i = 0;
+  if ( n >= 2 )
+  {
+    __m128d vmin = _mm_set1_pd( min ), vmax = _mm_set1_pd( max );
+    for ( ; i + 2 <= n; i += 2 )
+    {
+      __m128d v = _mm_loadu_pd( data + i );
+      __m128d lt = _mm_cmplt_pd( v, vmin );
+      __m128d gt = _mm_cmplt_pd( vmax, v );
+      vmin = _mm_or_pd( _mm_and_pd( lt, v ), _mm_andnot_pd( lt, vmin ) );
+      vmax = _mm_or_pd( _mm_and_pd( gt, v ), _mm_andnot_pd( gt, vmax ) );
+    }
+    double lanes_min[ 2 ], lanes_max[ 2 ];
+    _mm_storeu_pd( lanes_min, vmin );
+    _mm_storeu_pd( lanes_max, vmax );
+    min = lanes_min[ 0 ];
+    max = lanes_max[ 0 ];
+    min_max_lanes( lanes_min + 1, lanes_max + 1, 1, min, max );
+  }
+  min_max_scalar( data + i, n - i, min, max );
+}
+
+#endif
+
+#if defined( TIMELINE_USE_AVX2 )
+TIMELINE_TARGET_AVX2
+void add_avx2( double* dst, const double* src, size_t n )
+{
+  size_t i = 0;
+  for ( ; i + 4 <= n; i += 4 )
+    _mm256_storeu_pd( dst + i, _mm256_add_pd( _mm256_loadu_pd( dst + i ), _mm256_loadu_pd( src + i ) ) );
+  add_scalar( dst + i, src + i, n - i );
+}
+
+TIMELINE_TARGET_AVX2
+void divide_avx2( double* dst, const double* divisor, size_t n )
+{
+  size_t i = 0;
+  for ( ; i + 4 <= n; i += 4 )
+    _mm256_storeu_pd( dst + i, _mm256_div_pd( _mm256_loadu_pd( dst + i ), _mm256_loadu_pd( divisor + i ) ) );
+  divide_scalar( dst + i, divisor + i, n - i );
+}
+
+TIMELINE_TARGET_AVX2
+void min_max_avx2( const double* data, size_t n, double& min, double& max )
+{
+  size_t i = 0;
+  if ( n >= 4 )
+  {
+    __m256d vmin = _mm256_set1_pd( min ), vmax = _mm256_set1_pd( max );
+    for ( ; i + 4 <= n; i += 4 )
+    {
+      __m256d v = _mm256_loadu_pd( data + i );
+      vmin = _mm256_blendv_pd( vmin, v, _mm256_cmp_pd( v, vmin, _CMP_LT_OQ ) );
+      vmax = _mm256_blendv_pd( vmax, v, _mm256_cmp_pd( vmax, v, _CMP_LT_OQ ) );
+    }
+    double lanes_min[ 4 ], lanes_max[ 4 ];
+    _mm256_storeu_pd( lanes_min, vmin );
+    _mm256_storeu_pd( lanes_max, vmax );
+    min = lanes_min[ 0 ];
+    max = lanes_max[ 0 ];
+    min_max_lanes( lanes_min + 1, lanes_max + 1, 3, min, max );
+  }
+  min_max_scalar( data + i, n - i, min, max );
+}
+
+bool cpu_has_avx2()
+{
+#if defined( SC_VS )
+  int info[ 4 ];
+  __cpuid( info, 0 );
+  if ( info[ 0 ] < 7 )
+    return false;
+
+  // AVX state must be enabled by the OS as well
+  __cpuid( info, 1 );
+  if ( ( info[ 2 ] & ( 1 << 27 ) ) == 0 || ( info[ 2 ] & ( 1 << 28 ) ) == 0 )
+    return false;
+  if ( ( _xgetbv( 0 ) & 6 ) != 6 )
+    return false;
+
+  __cpuidex( info, 7, 0 );
+  return ( info[ 1 ] & ( 1 << 5 ) ) != 0;
+#else
+  return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+}
+#endif
+
+const kernels_t kernels[] = {
+  { ISA_SCALAR, add_scalar, divide_scalar, min_max_scalar },
+#if defined( TIMELINE_USE_SSE2 )
+  { ISA_SSE2, add_sse2, divide_sse2, min_max_sse2 },
+#endif
+#if defined( TIMELINE_USE_AVX2 )
+  { ISA_AVX2, add_avx2, divide_avx2, min_max_avx2 },
+#endif
+};
+
+const kernels_t* find_kernels( isa_e isa )
+{
+  for ( const auto& k : kernels )
+  {
+    if ( k.isa == isa )
+      return &k;
+  }
+
+  return &kernels[ 0 ];
+}
+
+const kernels_t*& active_kernels()
+{
+  static const kernels_t* k = find_kernels( detected_isa() );
+  return k;
+}
+
+} // unnamed namespace
+
+isa_e detected_isa()
+{
+#if defined( TIMELINE_USE_AVX2 )
+  static const bool has_avx2 = cpu_has_avx2();
+  if ( has_avx2 )
+    return ISA_AVX2;
+#endif
+#if defined( TIMELINE_USE_SSE2 )
+  return ISA_SSE2;
+#else
+  return ISA_SCALAR;
+#endif
+}
+
+isa_e active_isa()
+{ return active_kernels() -> isa; }
+
+isa_e set_isa( isa_e isa )
+{
+  if ( isa > detected_isa() )
+    isa = detected_isa();
+
+  active_kernels() = find_kernels( isa );
+  return active_isa();
+}
+
+const char* isa_name( isa_e isa )
+{
+  switch ( isa )
+  {
+    case ISA_SSE2: return "sse2";
+    case ISA_AVX2: return "avx2";
+    default:       return "scalar";
+  }
+}
+
+void add( double* dst, const double* src, size_t n )
+{ active_kernels() -> add( dst, src, n ); }
+
+void divide( double* dst, const double* divisor, size_t n )
+{ active_kernels() -> divide( dst, divisor, n ); }
+
+void min_max( const double* data, size_t n, double& min, double& max )
+{
+  if ( n == 0 )
+    return;
+
+  min = max = data[ 0 ];
+  active_kernels() -> min_max( data, n, min, max );
+}
+
+} // timeline_kernel
+
 #ifdef UNIT_TEST
+// Micro-benchmark of the scalar and vectorized timeline kernels
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+namespace {
+
+double elapsed_ms( std::chrono::high_resolution_clock::time_point start )
+{
+  return std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+}
+
+template <typename Fn>
+double run( size_t n_runs, Fn fn )
+{
+  auto start = std::chrono::high_resolution_clock::now();
+  for ( size_t i = 0; i < n_runs; ++i )
+    fn();
+  return elapsed_ms( start );
+}
+
+void bench( size_t length, size_t n_runs )
+{
+  std::mt19937_64 engine( length );
+  std::uniform_real_distribution<double> dist( 1.0, 1000.0 );
+  std::vector<double> a( length ), b( length );
+  for ( size_t i = 0; i < length; ++i )
+  {
+    a[ i ] = dist( engine );
+    b[ i ] = dist( engine );
+  }
+
+  std::cout << "length = " << length << ", runs = " << n_runs << "\n";
+
+  for ( int isa = timeline_kernel::ISA_SCALAR; isa <= timeline_kernel::detected_isa(); ++isa )
+  {
+    if ( timeline_kernel::set_isa( static_cast<timeline_kernel::isa_e>( isa ) ) != isa )
+      continue;
+
+    std::vector<double> dst = a;
+    double t_add = run( n_runs, [&]() { timeline_kernel::add( dst.data(), b.data(), length ); } );
+    double t_div = run( n_runs, [&]() { timeline_kernel::divide( dst.data(), b.data(), length ); } );
+    double min = 0, max = 0;
+    double t_minmax = run( n_runs, [&]() { timeline_kernel::min_max( a.data(), length, min, max ); } );
+
+    std::cout << "  " << std::setw( 7 ) << timeline_kernel::isa_name( timeline_kernel::active_isa() )
+              << std::fixed << std::setprecision( 3 )
+              << " add = " << t_add << " ms"
+              << ", divide = " << t_div << " ms"
+              << ", min_max = " << t_minmax << " ms\n";
+  }
+
+  std::cout << "\n";
+}
+
+} // unnamed namespace
 
 int main( int /*argc*/, char** /*argv*/ )
 {
-  tl::timeline_t<double> x;
+  std::cout << "Detected instruction set: " << timeline_kernel::isa_name( timeline_kernel::detected_isa() ) << "\n\n";
 
-  std::cout << sizeof( double );
+  // Timeline lengths of a typical fight, a long fight and a very long fight with
+  // fine bins
+  bench( 450, 100000 );
+  bench( 3600, 20000 );
+  bench( 100000, 500 );
 
   return 0;
 }
@@ -18,6 +18,27 @@
 
 struct sim_t;
 
+/* Kernels for the hot loops over timeline data. The best instruction set
+ * supported by the CPU is selected at runtime, with a scalar fallback.
+ */
+namespace timeline_kernel {
+
+enum isa_e { ISA_SCALAR, ISA_SSE2, ISA_AVX2 };
+
+isa_e detected_isa();
+isa_e active_isa();
+// Select the kernels used, capped to the detected instruction set. Not thread
+// safe, only meant for benchmarking.
+isa_e set_isa( isa_e isa );
+const char* isa_name( isa_e isa );
+
+void add( double* dst, const double* src, size_t n );
+void divide( double* dst, const double* divisor, size_t n );
+// Leaves min and max untouched if n is zero
+void min_max( const double* data, size_t n, double& min, double& max );
+
+} // timeline_kernel
+
 template <typename Fwd, typename Out>
 void sliding_window_average( Fwd first, Fwd last, unsigned window, Out out )
 {
@@ -111,6 +132,11 @@ public:
   }
 
   // Adjust timeline by dividing through divisor timeline
+  void adjust( const std::vector<double>& divisor_timeline )
+  {
+    timeline_kernel::divide( _data.data(), divisor_timeline.data(), std::min( _data.size(), divisor_timeline.size() ) );
+  }
+
   template <class A>
   void adjust( const std::vector<A>& divisor_timeline )
   {
@@ -141,8 +167,7 @@ public:
   void merge( const timeline_t& other )
   {
     // merge shared range
-    for ( size_t j = 0, num_buckets = std::min( _data.size(), other.data().size() ); j < num_buckets; ++j )
-      _data[ j ] += other.data()[ j ];
+    timeline_kernel::add( _data.data(), other.data().data(), std::min( _data.size(), other.data().size() ) );
 
     // if other is larger, insert tail
     if ( _data.size() < other.data().size() )
@@ -157,11 +182,19 @@ public:
 
   // Maximum value; 0 if no data available
   double max() const
-  { return data().empty() ? 0.0 : *std::max_element( data().begin(), data().end() ); }
+  {
+    double min = 0.0, max = 0.0;
+    timeline_kernel::min_max( _data.data(), _data.size(), min, max );
+    return max;
+  }
 
   // Minimum value; 0 if no data available
   double min() const
-  { return data().empty() ? 0.0 : *std::min_element( data().begin(), data().end() ); }
+  {
+    double min = 0.0, max = 0.0;
+    timeline_kernel::min_max( _data.data(), _data.size(), min, max );
+    return min;
+  }
 
   void clear()
   { _data.clear(); }
@@ -241,8 +274,8 @@ public:
   {
     if ( tl.data().empty() )
       return;
-    double min = *std::min_element( tl.data().begin(), tl.data().end() );
-    double max = *std::max_element( tl.data().begin(), tl.data().end() );
+    double min, max;
+    timeline_kernel::min_max( tl.data().data(), tl.data().size(), min, max );
     create_histogram( tl, num_buckets, min, max );
   }
 
@@ -264,8 +297,8 @@ public:
   {
     if ( sd.simple || sd.data().empty() )
       return;
-    double min = *std::min_element( sd.data().begin(), sd.data().end() );
-    double max = *std::max_element( sd.data().begin(), sd.data().end() );
+    double min, max;
+    timeline_kernel::min_max( sd.data().data(), sd.data().size(), min, max );
     create_histogram( sd, num_buckets, min, max );
   }
 
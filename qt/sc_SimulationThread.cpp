@@ -76,6 +76,12 @@ void SC_SimulateThread::run()
         error_str += QString::fromStdString( str );
       } );
     }
+
+    // Keep the work completed before the cancel for checkpoint_resume
+    if ( sim -> canceled )
+    {
+      sim -> checkpoint.save();
+    }
   }
   catch ( const std::exception& e )
   {
@@ -15,6 +15,7 @@
  HEADERS += engine/util/cache.hpp
  HEADERS += engine/sim/x7_pantheon.hpp
  HEADERS += engine/sim/sc_profileset.hpp
+ HEADERS += engine/sim/sc_checkpoint.hpp
  HEADERS += engine/sim/sc_option.hpp
  HEADERS += engine/sim/sc_expressions.hpp
  HEADERS += engine/report/sc_report.hpp
@@ -37,6 +38,7 @@
  SOURCES += engine/util/xml.cpp
  SOURCES += engine/util/str.cpp
  SOURCES += engine/util/stopwatch.cpp
+ SOURCES += engine/util/timeline.cpp
  SOURCES += engine/util/rng.cpp
  SOURCES += engine/util/io.cpp
  SOURCES += engine/util/concurrency.cpp
@@ -48,6 +50,7 @@
  SOURCES += engine/sim/sc_raid_event.cpp
  SOURCES += engine/sim/sc_progress_bar.cpp
  SOURCES += engine/sim/sc_profileset.cpp
+ SOURCES += engine/sim/sc_checkpoint.cpp
  SOURCES += engine/sim/sc_plot.cpp
  SOURCES += engine/sim/sc_option.cpp
  SOURCES += engine/sim/sc_gear_stats.cpp
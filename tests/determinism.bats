@@ -0,0 +1,23 @@
+load test_helper
+
+# Mean, error and range of the player dps in a text report. These only depend on the iterations
+# simulated, not on the order the threads merged them in.
+function dps_results() {
+  grep -o "DPS: [^ ]*  DPS-Error=[^ ]*  DPS-Range=[^ ]*" "$1"
+}
+
+@test "Counter-based rng streams give identical results with 1 and 4 threads" {
+  sim rng=philox threads=1 output="${BATS_TMPDIR}/rng_streams_1.txt"
+  [ "${status}" -eq 0 ]
+  sim rng=philox threads=4 output="${BATS_TMPDIR}/rng_streams_4.txt"
+  [ "${status}" -eq 0 ]
+  [ -n "$(dps_results "${BATS_TMPDIR}/rng_streams_1.txt")" ]
+  [ "$(dps_results "${BATS_TMPDIR}/rng_streams_1.txt")" == "$(dps_results "${BATS_TMPDIR}/rng_streams_4.txt")" ]
+}
+
+@test "Deterministic counter-based rng streams report low and high iterations" {
+  sim deterministic=1 rng=philox threads=2 iterations=40 output="${BATS_TMPDIR}/iteration_data.txt"
+  [ "${status}" -eq 0 ]
+  [ -z "$(echo "${output}" | grep "Duplicate seed")" ]
+  [ -n "$(grep "Low Iteration Data" "${BATS_TMPDIR}/iteration_data.txt")" ]
+}
@@ -0,0 +1,15 @@
+load test_helper
+
+# The fields of a sample data object in a json2 report
+function json2_metric() {
+  sed -n "/\"$2\": {/,/}/p" "$1"
+}
+
+@test "Lean collection stores samples only for the profileset metrics" {
+  sim lean_collection=1 profileset_metric=dps enemy=Enemy1 enemy=Enemy2 \
+      json2="${BATS_TMPDIR}/lean_collection.json"
+  [ "${status}" -eq 0 ]
+  [ -n "$(json2_metric "${BATS_TMPDIR}/lean_collection.json" prioritydps | grep '"mean"')" ]
+  [ -z "$(json2_metric "${BATS_TMPDIR}/lean_collection.json" prioritydps | grep '"median"')" ]
+  [ -n "$(json2_metric "${BATS_TMPDIR}/lean_collection.json" dps | grep '"median"')" ]
+}